@@ -65,47 +65,114 @@ a 'latch' anyway.
 */
 
 #include "LPD8806.h"
+#include "gamma.h"
+#include "pins.h"
+#include "profiler.h"
+
+#ifdef LPD8806_ASYNC
+// State shared with the SPI interrupt. There is a single SPI peripheral,
+// so at most one strip can be transmitting at any time.
+static const uint8_t * volatile txPtr;
+static volatile uint16_t        txCount;
+static volatile boolean         txBusy = false;
+
+// Serial Transfer Complete: feed the next byte of the frame.
+ISR(SPI_STC_vect) {
+  if(txCount) {
+    txCount--;
+    SPDR = *txPtr++;
+  } else {
+    SPCR  &= ~_BV(SPIE); // Frame done; stop interrupting
+    txBusy = false;
+  }
+}
+
+// Block until the previous frame has been completely sent.
+static inline void waitForTransmit(void) {
+  while(txBusy);
+}
+#endif
+
+// Color bytes go out in GRB order; this is the output curve for each.
+static const uint8_t * const wireCurve[3] = {
+  __gamma7[GAMMA_GREEN], __gamma7[GAMMA_RED], __gamma7[GAMMA_BLUE]
+};
+
+// What a color byte drives its LED with at full brightness: its value
+// after the output curve. 'pos' is the byte's place within its pixel.
+static inline uint8_t drive(uint8_t c, uint8_t pos) {
+  return pgm_read_byte(&wireCurve[pos][c & 0x7f]);
+}
+
+// Apply the output curve, then the global brightness (see setBrightness()
+// for the meaning of 'scale'), to a byte on its way out to the strip.
+// Scaling after the curve keeps the brightness levels linear in LED
+// drive, as they always were. 'pos' is the byte's place within its
+// pixel. Latch bytes, which have the high bit clear, pass through.
+static inline uint8_t outputColor(uint8_t c, uint8_t pos, uint8_t scale) {
+  if(!(c & 0x80)) return c;
+  c = drive(c, pos);
+  if(scale) c = (c * scale) >> 8;
+  return c | 0x80;
+}
 
 /*****************************************************************************/
 
 // Constructor for use with hardware SPI (specific clock/data pins):
 LPD8806::LPD8806(uint16_t n) {
-  pixels = NULL;
-  begun  = false;
-  enabled = false;
-  brightness = 0;
-  oldBrightness = 0;
+  init();
   updateLength(n);
   updatePins();
 }
 
 // Constructor for use with arbitrary clock/data pins:
 LPD8806::LPD8806(uint16_t n, uint8_t dpin, uint8_t cpin) {
-  pixels = NULL;
-  begun  = false;
-  enabled = false;
-  brightness = 0;
-  oldBrightness = 0;
+  init();
   updateLength(n);
   updatePins(dpin, cpin);
 }
 
+// Constructors as above, with the pixels in the caller's memory: 'buf'
+// holds bufferBytes(n) bytes. Nothing is allocated, so nothing can fail.
+LPD8806::LPD8806(uint8_t *buf, uint16_t n) {
+  init();
+  updateLength(n, buf);
+  updatePins();
+}
+
+LPD8806::LPD8806(uint8_t *buf, uint16_t n, uint8_t dpin, uint8_t cpin) {
+  init();
+  updateLength(n, buf);
+  updatePins(dpin, cpin);
+}
+
 // via Michael Vogt/neophob: empty constructor is used when strip length
 // isn't known at compile-time; situations where program config might be
 // read from internal flash memory or an SD card, or arrive via serial
 // command.  If using this constructor, MUST follow up with updateLength()
 // and updatePins() to establish the strip length and output pins!
 LPD8806::LPD8806(void) {
-  numLEDs = numBytes = 0;
-  pixels  = NULL;
-  begun   = false;
-  enabled = false;
+  init();
   updatePins(); // Must assume hardware SPI until pins are set
 }
 
+// Constructor body up to the length and pins: no pixels, nothing begun.
+void LPD8806::init(void) {
+  numLEDs = numBytes = dirtyEnd = origin = 0;
+  pixels = txBuffer = NULL;
+  callerMemory = false;
+  bitbangSetup = NULL;
+  bitbangByte  = NULL;
+  skippedShows = 0;
+  powerLimit = sentScale = 0;
+  begun  = false;
+  enabled = false;
+  brightness = 0;
+}
+
 void LPD8806::enable(boolean setBegun = false) {
   // Power up the led strip.
-  digitalWrite(13, LOW);
+  StripEnablePin::low();
   
   enabled = true;
   
@@ -115,13 +182,18 @@ void LPD8806::enable(boolean setBegun = false) {
 
 
 void LPD8806::disable(void) {
+#ifdef LPD8806_ASYNC
+  // Don't pull the rug out from under a frame that is still going out.
+  waitForTransmit();
+#endif
+
   // First, set the SPI mode such that the data and clock lines go low...
   if(hardwareSPI == true) {
     SPI.end();
   }
   
   // ...then power off the led strip.
-  digitalWrite(13, HIGH);
+  StripEnablePin::high();
 
   // Finaly, set status flags to indicate the strip is powered down and disabled.
   begun   = false;
@@ -147,12 +219,17 @@ void LPD8806::begin(void) {
   if(hardwareSPI == true) startSPI();
   else                    startBitbang();
   begun = true;
+
+  // The strip has just been powered up; its contents are unknown.
+  dirtyEnd = numLEDs;
 }
 
 // Change pin assignments post-constructor, switching to hardware SPI:
 void LPD8806::updatePins(void) {
   hardwareSPI = true;
   datapin     = clkpin = 0;
+  bitbangSetup = NULL;
+  bitbangByte  = NULL;
   // If begin() was previously invoked, init the SPI hardware now:
   if(begun == true) startSPI();
   // Otherwise, SPI is NOT initted until begin() is explicitly called.
@@ -168,8 +245,10 @@ void LPD8806::updatePins(uint8_t dpin, uint8_t cpin) {
   clkpin      = cpin;
   clkport = dataport = 0;
   clkpinmask = datapinmask = 0;
+  bitbangSetup = NULL;
+  bitbangByte  = NULL;
 
-#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || defined (__AVR_ATmega328__) || defined(__AVR_ATmega8__) || (__AVR_ATmega1281__) || defined(__AVR_ATmega2561__) || defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+#ifdef __AVR__ // Every AVR core has the pin to port tables, the 32U4 included
   clkport     = portOutputRegister(digitalPinToPort(cpin));
   clkpinmask  = digitalPinToBitMask(cpin);
   dataport    = portOutputRegister(digitalPinToPort(dpin));
@@ -227,6 +306,13 @@ void LPD8806::startBitbang() {
   if(! enabled)
     return;
     
+  if (bitbangByte != NULL) {
+    bitbangSetup();
+    for(uint16_t i=(numLEDs+31)/32; i>0; i--)
+      bitbangByte(0);
+    return;
+  }
+
   pinMode(datapin, OUTPUT);
   pinMode(clkpin , OUTPUT);
   if (dataport != 0) {
@@ -248,113 +334,299 @@ void LPD8806::startBitbang() {
 
 // Change strip length (see notes with empty constructor, above):
 void LPD8806::updateLength(uint16_t n) {
-  uint8_t latchBytes = (n + 31) / 32;
-  if(pixels != NULL) free(pixels); // Free existing data (if any)
+  releasePixels(); // Free existing data (if any)
   numLEDs    = n;
-  n         *= 3; // 3 bytes per pixel
-  numBytes   = n + latchBytes;
+  numBytes   = n * 3 + (n + 31) / 32; // 3 bytes per pixel + latch
   if(NULL != (pixels = (uint8_t *)malloc(numBytes))) { // Alloc new data
-    memset( pixels   , 0x80, n);          // Init to RGB 'off' state
-    memset(&pixels[n], 0   , latchBytes); // Clear latch bytes
+#ifdef LPD8806_ASYNC
+    // If there's no room for a second buffer, show() stays synchronous.
+    txBuffer = (uint8_t *)malloc(numBytes);
+#endif
   } else numLEDs = numBytes = 0; // else malloc failed
+  clearPixels();
   // 'begun' state does not change -- pins retain prior modes
 }
 
+// Change strip length, with the pixels in 'buf', bufferBytes(n) bytes of
+// the caller's memory. It stays the caller's; it is never freed here.
+void LPD8806::updateLength(uint16_t n, uint8_t *buf) {
+  releasePixels(); // Free existing data (if any)
+  numLEDs    = n;
+  numBytes   = n * 3 + (n + 31) / 32; // 3 bytes per pixel + latch
+  pixels     = buf;
+#ifdef LPD8806_ASYNC
+  txBuffer   = &buf[numBytes];
+#endif
+  callerMemory = true;
+  clearPixels();
+  // 'begun' state does not change -- pins retain prior modes
+}
+
+// Let go of the pixel data, once it is no longer being sent.
+void LPD8806::releasePixels(void) {
+#ifdef LPD8806_ASYNC
+  waitForTransmit();
+#endif
+  if(! callerMemory) {
+    if(txBuffer != NULL) free(txBuffer);
+    if(pixels   != NULL) free(pixels);
+  }
+  pixels = txBuffer = NULL;
+  callerMemory = false;
+}
+
+// Set every pixel off and clear the latch bytes.
+void LPD8806::clearPixels(void) {
+  uint16_t n = numLEDs * 3;
+  if(pixels != NULL) {
+    memset( pixels   , 0x80, n);            // Init to RGB 'off' state
+    memset(&pixels[n], 0   , numBytes - n); // Clear latch bytes
+  }
+  channelSum = 0;
+  dirtyEnd   = numLEDs;
+  origin     = 0;
+}
+
 uint16_t LPD8806::numPixels(void) {
   return numLEDs;
 }
 
+// Number of show() calls that sent nothing because no pixel had changed.
+uint32_t LPD8806::getSkippedShows(void) {
+  return skippedShows;
+}
+
 // This is how data is pushed to the strip.  Unfortunately, the company
 // that makes the chip didnt release the protocol document or you need
 // to sign an NDA or something stupid like that, but we reverse engineered
 // this from a strip controller and it seems to work very nicely!
 void LPD8806::show(void) {
+  ProfileScope profile(PROFILE_SHOW);
+
+#ifdef ORION_HOST
+  hostTrace.showCalls++;
+#endif
+
   if(! enabled)
     return;
 
   if(! begun)
     return;
         
-  uint8_t  *ptr = pixels;
-  uint16_t i    = numBytes;
+  // Nothing has changed since the last frame; the strip already shows it.
+  if(dirtyEnd == 0) {
+    skippedShows++;
+    return;
+  }
+
+  // Each LPD8806 latches its bytes as they arrive and keeps them until
+  // it is written again, so only the pixels up to the last one changed
+  // since the previous show() need to go out, followed by the latch.
+  uint16_t dataBytes  = dirtyEnd * 3;
+  uint16_t latchBytes = numBytes - numLEDs * 3;
+  dirtyEnd = 0;
+
+  // Brightness, power limited. Pixels that did not change still have to
+  // go out again when that comes out different from the last frame.
+  uint8_t scale = outputScale();
+  if(scale != sentScale) {
+    sentScale = scale;
+    dataBytes = numLEDs * 3;
+  }
+
+  // With the origin moved, the dirty range (kept by pixel number) does not
+  // map onto the strip, so any change sends the whole of it.
+  if(origin)
+    dataBytes = numLEDs * 3;
+
+  // The strip starts at the origin and wraps around to pixel 0, so the
+  // data goes out as the bytes from the origin on, then those before it.
+  const uint8_t *first = &pixels[origin * 3];
+  uint16_t firstBytes  = (numLEDs - origin) * 3;
+  if(firstBytes > dataBytes) firstBytes = dataBytes; // Origin 0, partial
+
+#ifdef LPD8806_ASYNC
+  if(hardwareSPI && txBuffer != NULL && latchBytes) {
+    // Wait for the previous frame, then copy this one out of the way
+    // and let the SPI interrupt send it. The copy (rather than a pointer
+    // swap) keeps 'pixels' intact for modes that only redraw part of
+    // the strip each frame. Rendering of the next frame now overlaps
+    // with this one being clocked out.
+    // Gamma and the output scale are applied on the way into the buffer.
+    waitForTransmit();
+    const uint8_t *src = first;
+    for(uint16_t i=0; i<dataBytes; i+=3, src+=3) {
+      if(i == firstBytes) src = pixels;
+      txBuffer[i    ] = outputColor(src[0], 0, scale);
+      txBuffer[i + 1] = outputColor(src[1], 1, scale);
+      txBuffer[i + 2] = outputColor(src[2], 2, scale);
+    }
+    memset(&txBuffer[dataBytes], 0, latchBytes);
+    txPtr   = txBuffer + 1;
+    txCount = dataBytes + latchBytes - 1;
+    txBusy  = true;
+    SPCR   |= _BV(SPIE);
+    SPDR    = txBuffer[0];
+    return;
+  }
+#endif
+
+  send(first, firstBytes, scale);
+  send(pixels, dataBytes - firstBytes, scale);
+  send(&pixels[numLEDs * 3], latchBytes, 0);
+}
+
+// Issue bytes to the strip over hard or soft SPI, waiting for each one,
+// passing color bytes through outputColor() as they go out. 'ptr' must
+// start on a pixel boundary.
+void LPD8806::send(const uint8_t *ptr, uint16_t i, uint8_t scale) {
+  uint8_t pos = 0; // Place of the next byte within its pixel
+
+  if(! i)
+    return;
 
-  // This doesn't need to distinguish among individual pixel color
-  // bytes vs. latch data, etc.  Everything is laid out in one big
-  // flat buffer and issued the same regardless of purpose.
   if(hardwareSPI) {
-    while(i--) {
-#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || defined (__AVR_ATmega328__) || defined(__AVR_ATmega8__) || (__AVR_ATmega1281__) || defined(__AVR_ATmega2561__) || defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
-      while(!(SPSR & (1<<SPIF))); // Wait for prior byte out
-      SPDR = *ptr++;              // Issue new byte
+#ifdef __AVR__
+    // Prepare the next byte while the current one is being shifted out.
+    uint8_t next = outputColor(*ptr++, pos, scale);
+    while(--i) {
+      SPDR = next;                // Issue new byte
+      if(++pos == 3) pos = 0;
+      next = outputColor(*ptr++, pos, scale);
+      while(!(SPSR & (1<<SPIF))); // Wait for it to go out
+    }
+    SPDR = next;
+    while(!(SPSR & (1<<SPIF)));
 #else
-      SPI.transfer(*ptr++);
+    while(i--) {
+      SPI.transfer(outputColor(*ptr++, pos, scale));
+      if(++pos == 3) pos = 0;
+    }
 #endif
+  } else if(bitbangByte != NULL) {
+    // Compile-time pins
+    while(i--) {
+      bitbangByte(outputColor(*ptr++, pos, scale));
+      if(++pos == 3) pos = 0;
+    }
+  } else if(dataport != 0) {
+    uint8_t p, bit;
+
+    while(i--) {
+      p = outputColor(*ptr++, pos, scale);
+      if(++pos == 3) pos = 0;
+      for(bit=0x80; bit; bit >>= 1) {
+	if(p & bit) *dataport |=  datapinmask;
+	else        *dataport &= ~datapinmask;
+	*clkport |=  clkpinmask;
+	*clkport &= ~clkpinmask;
+      }
     }
   } else {
     uint8_t p, bit;
 
     while(i--) {
-      p = *ptr++;
+      p = outputColor(*ptr++, pos, scale);
+      if(++pos == 3) pos = 0;
       for(bit=0x80; bit; bit >>= 1) {
-	if (dataport != 0) {
-	  if(p & bit) *dataport |=  datapinmask;
-	  else        *dataport &= ~datapinmask;
-	  *clkport |=  clkpinmask;
-	  *clkport &= ~clkpinmask;
-	} else {
-	  if (p&bit) digitalWrite(datapin, HIGH);
-	  else digitalWrite(datapin, LOW);
-	  digitalWrite(clkpin, HIGH);
-	  digitalWrite(clkpin, LOW);
-	}
+	if (p&bit) digitalWrite(datapin, HIGH);
+	else digitalWrite(datapin, LOW);
+	digitalWrite(clkpin, HIGH);
+	digitalWrite(clkpin, LOW);
       }
     }
   }
 }
 
-// Convert separate R,G,B into combined 32-bit GRB color:
-uint32_t LPD8806::Color(byte r, byte g, byte b) {
-  return ((uint32_t)(g | 0x80) << 16) |
-         ((uint32_t)(r | 0x80) <<  8) |
-                     b | 0x80 ;
+// Store one pixel, already in wire format, keeping channelSum and the
+// dirty range up to date. 'n' must be in range.
+inline void LPD8806::storePixel(uint16_t n, uint8_t g, uint8_t r, uint8_t b) {
+  uint8_t *p = &pixels[n * 3];
+  if(p[0] != g || p[1] != r || p[2] != b) {
+    // Add and take off in two steps: on AVR an int is 16 bits, so one
+    // difference of the two would wrap around when the pixel gets dimmer.
+    channelSum += (uint16_t)(drive(g, 0) + drive(r, 1) + drive(b, 2));
+    channelSum -= (uint16_t)(drive(p[0], 0) + drive(p[1], 1) + drive(p[2], 2));
+    p[0] = g;
+    p[1] = r;
+    p[2] = b;
+    if(n >= dirtyEnd) dirtyEnd = n + 1;
+  }
 }
 
-// Set pixel color from separate 7-bit R, G, B components:
-void LPD8806::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+// Set pixel color from 'packed' 32-bit GRB (not RGB) value, 7 bits a
+// channel; PixelFormat<7, ORDER_GRB, 0x80> in strip.h packs these.
+void LPD8806::setPixelColor(uint16_t n, uint32_t c) {
+#ifdef ORION_HOST
+  hostTrace.setPixelCalls++;
+#endif
   if(n < numLEDs) { // Arrays are 0-indexed, thus NOT '<='
-      if(brightness != 0) 
-      {
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-      }
-    uint8_t *p = &pixels[n * 3];
-    *p++ = g | 0x80; // Strip color order is GRB,
-    *p++ = r | 0x80; // not the more common RGB,
-    *p++ = b | 0x80; // so the order here is intentional; don't "fix"
+    // Strip color order is GRB, not the more common RGB,
+    // so the order here is intentional; don't "fix"
+    storePixel(n, (uint8_t)(c >> 16) | 0x80,
+                  (uint8_t)(c >>  8) | 0x80,
+                  (uint8_t)c         | 0x80);
   }
 }
 
-// Set pixel color from 'packed' 32-bit GRB (not RGB) value:
-void LPD8806::setPixelColor(uint16_t n, uint32_t c) {
-  if(n < numLEDs) { // Arrays are 0-indexed, thus NOT '<='
-      uint8_t
-      g = (uint8_t)((c >> 16) & 0x7f),
-      r = (uint8_t)((c >>  8) & 0x7f),
-      b = (uint8_t)(c        & 0x7f);
-    if(brightness != 0) 
-    {
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
-      uint8_t *p = &pixels[n * 3];
-    *p++ = g | 0x80; // Strip color order is GRB,
-    *p++ = r | 0x80; // not the more common RGB,
-    *p++ = b | 0x80; // so the order here is intentional; don't "fix"
+// Set 'count' pixels from 'start' on to one packed color, as taken by
+// setPixelColor(). Pixels past the end of the strip are left out.
+void LPD8806::fill(uint16_t start, uint16_t count, uint32_t c) {
+  if(start >= numLEDs) return;
+  if(count > numLEDs - start) count = numLEDs - start;
+
+  uint8_t
+    g = (uint8_t)(c >> 16) | 0x80,
+    r = (uint8_t)(c >>  8) | 0x80,
+    b = (uint8_t)c         | 0x80;
+  for(uint16_t n = start; n < start + count; n++)
+    storePixel(n, g, r, b);
+}
+
+// Set 'count' pixels from 'start' on to packed colors from 'colors'.
+// Pixels past the end of the strip are left out.
+void LPD8806::setPixels(uint16_t start, const uint32_t *colors, uint16_t count) {
+  if(start >= numLEDs) return;
+  if(count > numLEDs - start) count = numLEDs - start;
+
+  for(uint16_t n = start; n < start + count; n++) {
+    uint32_t c = *colors++;
+    storePixel(n, (uint8_t)(c >> 16) | 0x80,
+                  (uint8_t)(c >>  8) | 0x80,
+                  (uint8_t)c         | 0x80);
+  }
+}
+
+uint8_t *LPD8806::getPixels(void) {
+  return pixels;
+}
+
+// Pixels were written directly: recount them and send them all.
+void LPD8806::pixelsChanged(void) {
+  channelSum = 0;
+  for(uint16_t i = 0; i < numLEDs * 3; i += 3)
+    channelSum += (uint16_t)drive(pixels[i], 0) + drive(pixels[i + 1], 1) +
+                            drive(pixels[i + 2], 2);
+  dirtyEnd = numLEDs;
+}
+
+// Have show() send pixel 'n' to the first LED of the strip, the pixels
+// after it to the LEDs after that and, wrapping around, pixels 0 to n-1
+// to the last ones. Pixel numbers stay where they are in the pixel data,
+// so a pattern that scrolls around the strip is drawn once and then moved
+// by changing the origin alone. 'n' past the end wraps around too.
+void LPD8806::setOrigin(uint16_t n) {
+  if(n >= numLEDs) n = numLEDs ? n % numLEDs : 0;
+  if(n != origin) {
+    origin   = n;
+    dirtyEnd = numLEDs;
   }
 }
 
+uint16_t LPD8806::getOrigin(void) {
+  return origin;
+}
+
 // Query color from previously-set pixel (returns packed 32-bit GRB value)
 uint32_t LPD8806::getPixelColor(uint16_t n) {
   if(n < numLEDs) {
@@ -375,30 +647,38 @@ void LPD8806::setBrightness(uint8_t b) {
   // (color values are interpreted literally; no scaling), 1 = min
   // brightness (off), 255 = just below max brightness.
   uint8_t newBrightness = b + 1;
-  
-  // Redraw the pixels
-  if(newBrightness != brightness) { // Compare against prior value
-    // Brightness has changed -- re-scale existing data in RAM
-    uint8_t  c,
-            *ptr           = pixels;
-    uint16_t scale;
-    if(oldBrightness == 0) scale = 0; // Avoid /0
-    else if(b == 255) scale = 65535 / oldBrightness;
-    else scale = (uint8_t)((newBrightness << 8) - 1) / oldBrightness;
 
+  // The pixel data is kept at full brightness and only scaled as it is
+  // sent, so all a change needs is a full redraw on the next show().
+  if(newBrightness != brightness) { // Compare against prior value
     brightness = newBrightness;
-    oldBrightness = newBrightness;
-
-    // Force re-draw of the LEDs
-    for(uint16_t i=0; i<numLEDs; i++) 
-    {
-      uint32_t singlePixel = getPixelColor(i);
-      uint8_t
-      gt = (uint8_t)((singlePixel >> 16) & 0x7f),
-      rt = (uint8_t)((singlePixel >>  8) & 0x7f),
-      bt = (uint8_t)(singlePixel        & 0x7f);
-
-      setPixelColor(i, rt, gt, bt);
-    }
+    dirtyEnd   = numLEDs;
   }
 }
+
+// Cap the power drawn by the strip: 'limit' is the largest sum of the
+// drive of all the channels (0-127 each, after the output curves) that may
+// be shown at once (0 for no limit). Frames that would go over it are
+// dimmed as they are sent until they fit.
+void LPD8806::setPowerLimit(uint32_t limit) {
+  if(limit != powerLimit) {
+    powerLimit = limit;
+    dirtyEnd   = numLEDs;
+  }
+}
+
+// The scale show() applies: the brightness, lowered further if the frame
+// would otherwise go over the power limit. The channel sum is of the
+// values after the output curves, what the LEDs are actually driven with,
+// and the brightness scales that linearly. Same encoding as 'brightness'.
+uint8_t LPD8806::outputScale(void) {
+  if(!powerLimit)
+    return brightness;
+
+  uint32_t drawn = brightness ? (channelSum * brightness) >> 8 : channelSum;
+  if(drawn <= powerLimit)
+    return brightness;
+
+  uint8_t scale = (powerLimit << 8) / channelSum; // < brightness here
+  return scale ? scale : 1;                       // 0 would mean full
+}
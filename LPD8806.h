@@ -10,52 +10,162 @@
 
 #include <SPI.h>
 
+// Define as 1 to have show(), with hardware SPI, hand a copy of the frame
+// to the SPI interrupt and return while it is being sent. This costs a
+// second copy of the pixel data in RAM and at the default SPI clock gains
+// next to nothing: a byte goes out every 64 CPU cycles, and taking the
+// interrupt for it (entry, saving registers, the 16-bit volatile pointer
+// and count, reti) costs about 60 of them, so the drawing of the next
+// frame barely runs and the bytes go out further apart. Measure with the
+// profiler (render plus show time per frame) before turning it on, e.g.
+// with a slower SPI clock.
+#ifndef LPD8806_ASYNC_SHOW
+ #define LPD8806_ASYNC_SHOW 0
+#endif
+
+#if LPD8806_ASYNC_SHOW && defined(SPI_STC_vect)
+ #define LPD8806_ASYNC
+#endif
+
 class LPD8806 {
 
  public:
 
   LPD8806(uint16_t n, uint8_t dpin, uint8_t cpin); // Configurable pins
   LPD8806(uint16_t n); // Use SPI hardware; specific pins only
+  // As above, with the pixels in 'buf', bufferBytes(n) bytes of the
+  // caller's memory, instead of memory allocated here.
+  LPD8806(uint8_t *buf, uint16_t n, uint8_t dpin, uint8_t cpin);
+  LPD8806(uint8_t *buf, uint16_t n);
   LPD8806(void); // Empty constructor; init pins & strip length later
   void
     begin(void),
     show(void),
-    setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
     setPixelColor(uint16_t n, uint32_t c),
+    fill(uint16_t start, uint16_t count, uint32_t c), // Set a run of pixels to one color
+    setPixels(uint16_t start, const uint32_t *colors, uint16_t count), // Set a run of pixels from an array
+    pixelsChanged(void), // Call after writing through getPixels()
+    setOrigin(uint16_t n), // Pixel that show() sends first
     updatePins(uint8_t dpin, uint8_t cpin), // Change pins, configurable
     updatePins(void),                       // Change pins, hardware SPI
     updateLength(uint16_t n),               // Change strip length
+    updateLength(uint16_t n, uint8_t *buf), // Change strip length, pixels in 'buf'
     enable(boolean setBegun),  // Power up, activate SPI
     disable(void),             // Power down, disable SPI
-    setBrightness(uint8_t);
+    setBrightness(uint8_t),
+    setPowerLimit(uint32_t limit);
     boolean isEnabled(void);   // 
     boolean isDisabled(void);  // 
+  // Change pins, bit-banged on pins fixed at compile time: Pin types from
+  // pins.h, e.g. updatePins<Pin<PORT_D, 4>, Pin<PORT_D, 7> >() for data on
+  // D4 and clock on D6, which the board leaves free. Each byte
+  // goes out as an unrolled run of port instructions, which is much
+  // faster than the configurable pins and works on any AVR.
+  template<class DataPin, class ClockPin>
+    void updatePins(void);
   uint16_t
-    numPixels(void);
+    numPixels(void),
+    getOrigin(void);
+  // Bytes of memory the strip needs for 'n' pixels, for 'buf' above: the
+  // pixels and the latch, and a copy of those for the async show.
+  static constexpr uint16_t bufferBytes(uint16_t n) {
+#ifdef LPD8806_ASYNC
+    return 2 * (n * 3 + (n + 31) / 32);
+#else
+    return n * 3 + (n + 31) / 32;
+#endif
+  }
+  // The pixel data itself, 3 bytes per pixel in GRB order, each with the
+  // high bit set. Nothing is checked; call pixelsChanged() when done.
+  uint8_t
+    *getPixels(void);
   uint32_t
-    Color(byte, byte, byte),
-    getPixelColor(uint16_t n);
+    getPixelColor(uint16_t n),
+    getSkippedShows(void);
 
  private:
   uint16_t
     numLEDs,    // Number of RGB LEDs in strip
-    numBytes;   // Size of 'pixels' buffer below
+    numBytes,   // Size of 'pixels' buffer below
+    dirtyEnd,   // One past the last pixel changed since the last show()
+    origin;     // Pixel sent first by show(), see setOrigin()
+  uint32_t
+    skippedShows, // show() calls with nothing to send
+    channelSum,   // Sum of the drive of all channels in 'pixels', see drive()
+    powerLimit;   // Largest channelSum to show unscaled, 0 for no limit
   uint8_t
     *pixels,    // Holds LED color values (3 bytes each) + latch
+    *txBuffer,  // Frame being sent by the SPI interrupt (async show only)
     clkpin    , datapin,     // Clock & data pin numbers
     clkpinmask, datapinmask, // Clock & data PORT bitmasks
-    brightness,    // Global brightness
-    oldBrightness;
+    brightness,    // Global brightness, applied as pixels are sent
+    sentScale,     // Output scale of the last frame sent
+    outputScale(void);
   volatile uint8_t
     *clkport  , *dataport;   // Clock & data PORT registers
   void
+    (*bitbangSetup)(void),     // Compile-time pins: make them outputs
+    (*bitbangByte)(uint8_t b), // Compile-time pins: clock a byte out
     startBitbang(void),
-    startSPI(void);
+    startSPI(void),
+    init(void),
+    releasePixels(void),
+    clearPixels(void),
+    storePixel(uint16_t n, uint8_t g, uint8_t r, uint8_t b),
+    send(const uint8_t *ptr, uint16_t n, uint8_t scale);
+  template<class DataPin, class ClockPin>
+    static void setupPinsFixed(void);
+  template<class DataPin, class ClockPin>
+    static void sendByteFixed(uint8_t b);
+  template<class DataPin, class ClockPin, uint8_t Bit>
+    static void sendBitFixed(uint8_t b);
   boolean
     hardwareSPI, // If 'true', using hardware SPI
     begun,       // If 'true', begin() method was previously invoked
-    enabled;     // If 'true', power up the strip and allow data push, else power down
+    enabled,     // If 'true', power up the strip and allow data push, else power down
+    callerMemory; // If 'true', 'pixels' is the caller's, not allocated here
 };
 
+template<class DataPin, class ClockPin>
+void LPD8806::updatePins(void) {
+  if(begun == true && hardwareSPI == true) SPI.end();
+  hardwareSPI  = false;
+  datapin      = clkpin = 0;
+  dataport     = clkport = 0;
+  bitbangSetup = &setupPinsFixed<DataPin, ClockPin>;
+  bitbangByte  = &sendByteFixed<DataPin, ClockPin>;
+  // If begin() was previously invoked, enable the new pins now.
+  if(begun == true) startBitbang();
+}
+
+template<class DataPin, class ClockPin>
+void LPD8806::setupPinsFixed(void) {
+  DataPin::low();
+  ClockPin::low();
+  DataPin::output();
+  ClockPin::output();
+}
+
+template<class DataPin, class ClockPin, uint8_t Bit>
+inline void LPD8806::sendBitFixed(uint8_t b) {
+  if(b & Bit) DataPin::high();
+  else        DataPin::low();
+  ClockPin::high();
+  ClockPin::low();
+}
+
+// MSB first, unrolled.
+template<class DataPin, class ClockPin>
+void LPD8806::sendByteFixed(uint8_t b) {
+  sendBitFixed<DataPin, ClockPin, 0x80>(b);
+  sendBitFixed<DataPin, ClockPin, 0x40>(b);
+  sendBitFixed<DataPin, ClockPin, 0x20>(b);
+  sendBitFixed<DataPin, ClockPin, 0x10>(b);
+  sendBitFixed<DataPin, ClockPin, 0x08>(b);
+  sendBitFixed<DataPin, ClockPin, 0x04>(b);
+  sendBitFixed<DataPin, ClockPin, 0x02>(b);
+  sendBitFixed<DataPin, ClockPin, 0x01>(b);
+}
+
 #endif
 
@@ -1,66 +1,94 @@
 #include <SPI.h>
 #include <avr/sleep.h>
-#include "PinChangeInt.h"
 #include "pins.h"
+#include "buttons.h"
 #include "batteryStatus.h"
 #include "orion.h"
+#include "profiler.h"
 
 boolean poweredOn = false;
-boolean powerSemaphore = false;
-int powerCounter = 0;
 
-void togglePower(void) 
+// Wakes the CPU from power down on the release of the power button. Timer0
+// and with it the button sampling were stopped, so the debouncer never saw
+// the button LOW; count it as pressed, and the release is debounced into
+// the BUTTON_POWER event as usual.
+void wakeUp(void) 
 {
-  powerSemaphore = true;
-} // togglePower()
+  pressButton(BUTTON_POWER);
+} // wakeUp()
+
+
+// Sleeps in power down until the power button wakes the CPU, unless a
+// press is still on its way through the debouncer, which needs Timer0.
+void powerDown(void)
+{
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  cli();
+  if(!buttonsSettling() && !buttonEventPending())
+  {
+    sleep_enable();
+    // The instruction after sei() runs before any interrupt, so a wake-up
+    // cannot slip in between the check and going to sleep.
+    sei();
+    sleep_cpu();  //sleep now
+    sleep_disable(); //fully awake now
+  }
+  sei();
+} // powerDown()
 
 
 void setup() 
 {
   setupPins();
   
-  // Make the ADC use the nternal 2.56v reference.
-  analogReference(INTERNAL);
-  
   // The unit should be off on powerup.
   poweredOn = false; 
   
-  // Attach button interrupts
+  // Sample the buttons from the Timer0 interrupt.
   interrupts();
-  PCintPort::attachInterrupt(PIN_BUTTON_MODE, &stepMode, RISING);
-  PCintPort::attachInterrupt(PIN_BUTTON_SPEED, &stepSpeed, RISING);
-  attachInterrupt(INT1, &stepBrightness, RISING);
-  attachInterrupt(INT0, &togglePower, RISING);
-// Does not work. ???
-//  attachInterrupt(PIN_BUTTON_LEVEL, &stepBrightness, FALLING);
-//  attachInterrupt(PIN_BUTTON_POWER, &togglePower, FALLING);
+  setupButtons();
+  attachInterrupt(INT0, &wakeUp, RISING);
   
+  // Also sets up the ADC, on the internal 2.56v reference.
   setupBatteryStatusInterrupt();  
   setupOrion();
+  setupProfiler();
 } // setup()
 
 
-void loop() {
-  
-  if(powerSemaphore)
-  {
-  if(digitalRead(PIN_BUTTON_POWER)==HIGH)
+// Acts on a debounced button press. Presses other than power are
+// dropped while the unit is off.
+void handleButton(uint8_t button)
+{
+  if(button == BUTTON_POWER)
+    poweredOn = !poweredOn;
+  else if(poweredOn && isEnabled())
   {
-    powerCounter++; 
-  } else {
-    powerSemaphore = false; // Disarm the semaphore (button press time < minimum) 
-    powerCounter = 0;
+    if(button == BUTTON_LEVEL)
+      stepBrightness();
+    if(button == BUTTON_SPEED)
+      stepSpeed();
+    if(button == BUTTON_MODE)
+      stepMode();
   }
+} // handleButton()
+
+
+void loop() {
   
-  if(powerCounter>10)
-    {
-    poweredOn = !poweredOn;
-    powerSemaphore = false;
-    powerCounter = 0;
-    } 
+  // Take every press queued since the previous pass, oldest first.
+  uint16_t profileStart = profileBegin(PROFILE_INPUT);
+  ButtonEvent event;
+  while(takeButtonEvent(event))
+  {
+    handleButton(event.button);
+    profileLatency(micros() - event.micros);
   }
+  profileEnd(PROFILE_INPUT, profileStart);
   
+  profileStart = profileBegin(PROFILE_BATTERY);
   updateBatteryStatus(poweredOn);
+  profileEnd(PROFILE_BATTERY, profileStart);
 
   // Start up the device
   if(poweredOn && isDisabled())
@@ -72,13 +100,6 @@ void loop() {
     disable();
     // Ensure that the status LED is off
     forceStatusLightOff();
-    // Define sleep type
-    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
-   // Attach the awake interrupt to the power button
-   //attachInterrupt(INT0,sleepHandler, FALLING); 
-   sleep_enable();
-   sleep_mode();  //sleep now
-   sleep_disable(); //fully awake now 
   }
 
   // Update the LEDs if the device is enabled
@@ -87,6 +108,16 @@ void loop() {
     updateOrion();
   }
 
+  // Answer profile report requests, if profiling is compiled in.
+  updateProfiler();
+
+  // Rather than spin until the next frame is due, idle the CPU. While off,
+  // sleep until the power button is pressed, every pass, whatever woke it.
+  if(poweredOn)
+    idleUntilNextFrame();
+  else
+    powerDown();
+
 
 } // loop()
 
@@ -34,30 +34,136 @@
   --------------------------------------------------------------------*/
 
 #include "WS2811.h"
+#include "gamma.h"
+#include "pins.h"
+#include "profiler.h"
+
+// With NEO_SPI, the bitstream is produced by the SPI peripheral instead of
+// timed instructions, so interrupts can stay on while a frame goes out.
+// Each data bit becomes four SPI bits, 1000 for a 0 and 1110 for a 1, at
+// F_CPU/4 (1 us per data bit at 16 MHz) for 800 KHz pixels or F_CPU/8 for
+// 400 KHz ones. The SPI data register is not buffered, so MOSI idles low
+// for a moment between bytes; that only stretches the low part of a bit,
+// as does any interrupt taken mid-frame. An interrupt must not hold off the
+// next byte for 50 us or more, or the strip latches early.
+// The host build takes the same path, capturing the SPI bytes instead
+// (host/spiCheck.cpp checks them against the WS2812 timings).
+#if (defined(SPDR) && defined(__AVR__)) || defined(ORION_HOST)
+ #define WS2811_SPI
+#endif
+
+#ifdef WS2811_SPI
+// SPI bytes for two data bits at a time, high bits first.
+static const uint8_t spiPatterns[4] = { 0x88, 0x8E, 0xE8, 0xEE };
+
+// False if the SPI has dropped out of master mode (SS pulled low, see
+// startSPI()): it would then wait for a clock from outside, forever.
+static inline boolean spiPut(uint8_t b) {
+#ifdef ORION_HOST
+  hostSpiWrite(b);
+#else
+  SPDR = b;
+  while(!(SPSR & _BV(SPIF)))
+    if(!(SPCR & _BV(MSTR))) return false;
+#endif
+  return true;
+}
+
+// False if the frame was abandoned partway, see spiPut().
+static boolean spiSend(const uint8_t *ptr, uint16_t n) {
+  while(n--) {
+    uint8_t b = *ptr++;
+    if(!spiPut(spiPatterns[ b >> 6     ]) ||
+       !spiPut(spiPatterns[(b >> 4) & 3]) ||
+       !spiPut(spiPatterns[(b >> 2) & 3]) ||
+       !spiPut(spiPatterns[ b       & 3])) return false;
+  }
+  return true;
+}
+#endif
+
+#if defined(__AVR__) && (ARDUINO >= 100)
+// Timer0 bookkeeping of the Arduino core (wiring.c).
+extern volatile unsigned long timer0_overflow_count, timer0_millis;
+
+// Timer0 overflows every 1024 us at 16 MHz, but with interrupts off only
+// the first overflow of a frame is kept (as a pending flag), so millis()
+// and micros() fall behind by the rest. Count the overflows from the
+// frame's expected length and where the counter started and stopped, and
+// add back those that were lost. The estimate only has to be good to half
+// a Timer0 period. Call with interrupts still off.
+static void compensateTimer0(uint8_t startCount, uint32_t frameMicros) {
+  static uint16_t lostFraction; // Lost microseconds not yet added to millis
+
+  uint8_t endCount  = TCNT0;
+  int32_t ticks     = frameMicros / (64000000UL / F_CPU);
+  int32_t overflows = (ticks + startCount - endCount + 128) >> 8;
+
+  if(overflows <= 1)
+    return;
+
+  uint16_t lost = overflows - 1;
+  timer0_overflow_count += lost;
+  // 1024 us each: a millisecond and 24 us over.
+  lostFraction  += lost * 24;
+  timer0_millis += lost + lostFraction / 1000;
+  lostFraction  %= 1000;
+}
+#endif
 
 WS2811::WS2811(uint16_t n, uint8_t p, uint8_t t) {
+  init(n, p, t, (uint8_t *)malloc(bufferBytes(n)));
+}
+
+// The pixels in the caller's memory: 'buf' holds bufferBytes(n) bytes.
+// Nothing is allocated, so nothing can fail.
+WS2811::WS2811(uint8_t *buf, uint16_t n, uint8_t p, uint8_t t) {
+  init(n, p, t, buf);
+}
+
+// Constructor body; 'buf' is NULL when allocating it failed.
+void WS2811::init(uint16_t n, uint8_t p, uint8_t t, uint8_t *buf) {
   numBytes = n * 3;
-  if((pixels = (uint8_t *)malloc(numBytes))) {
+  if((pixels = buf)) {
     memset(pixels, 0, numBytes);
+    wire    = &buf[numBytes];
     numLEDs = n;
+    origin  = 0;
+#ifndef WS2811_SPI
+    t      &= ~NEO_SPI;
+#endif
     type    = t;
-    pin     = p;
+    // Output curve for each byte of a pixel, in the strip's color order.
+    curve[0] = __gamma8[((t & NEO_COLMASK) == NEO_GRB) ? GAMMA_GREEN : GAMMA_RED];
+    curve[1] = __gamma8[((t & NEO_COLMASK) == NEO_GRB) ? GAMMA_RED : GAMMA_GREEN];
+    curve[2] = __gamma8[GAMMA_BLUE];
+    hardwareSPI = (t & NEO_SPI) != 0;
+    pin     = hardwareSPI ? MOSI : p;
     port    = portOutputRegister(digitalPinToPort(p));
     pinMask = digitalPinToBitMask(p);
     endTime = 0L;
+    skippedShows = 0L;
+    channelSum   = 0L;
+    powerLimit   = 0L;
+    brightness   = 0;
+    dirty   = true;
   } else {
-    numLEDs = 0;
+    numLEDs = origin = 0;
   }
 }
 
 void WS2811::begin(void) {
   pinMode(pin, OUTPUT);
   digitalWrite(pin, LOW);
+  if(hardwareSPI) startSPI();
+
+  // The strip has just been powered up; its contents are unknown.
+  dirty = true;
 }
 
 void WS2811::enable(boolean setBegun = false) {
   // Power up the led strip.
-  digitalWrite(13, LOW);
+  StripEnablePin::low();
   
   enabled = true;
   
@@ -69,11 +175,13 @@ void WS2811::enable(boolean setBegun = false) {
 void WS2811::disable(void) {
   // First, set the SPI mode such that the data and clock lines go low...
   if(hardwareSPI == true) {
-//    SPI.end();
+#if defined(WS2811_SPI) && defined(__AVR__)
+    SPCR = 0; // MOSI goes back to the PORT, which is low
+#endif
   }
   
   // ...then power off the led strip.
-  digitalWrite(13, HIGH);
+  StripEnablePin::high();
 
   // Finaly, set status flags to indicate the strip is powered down and disabled.
   begun   = false;
@@ -93,6 +201,23 @@ boolean WS2811::isDisabled(void) {
 
 
 
+// Master, MSB first, mode 0, no interrupt. SS is not made an output (on
+// the Leonardo it is a button), so pulling it low drops the SPI out of
+// master mode; spiSend() then gives up on the frame and show() sets master
+// mode again for the next one.
+void WS2811::startSPI(void) {
+#if defined(WS2811_SPI) && defined(__AVR__)
+  if((type & NEO_SPDMASK) == NEO_KHZ800) {
+    SPCR = _BV(SPE) | _BV(MSTR);             // F_CPU/4
+    SPSR = 0;
+  } else {
+    SPCR = _BV(SPE) | _BV(MSTR) | _BV(SPR0); // F_CPU/8
+    SPSR = _BV(SPI2X);
+  }
+#endif
+} // startSPI()
+
+
 #ifdef __arm__
 static inline void delayShort(uint32_t) __attribute__((always_inline, unused));
 static inline void delayShort(uint32_t num)
@@ -111,16 +236,69 @@ static inline void delayShort(uint32_t num)
 
 
 void WS2811::show(void) {
+  ProfileScope profile(PROFILE_SHOW);
+
+#ifdef ORION_HOST
+  hostTrace.showCalls++;
+#endif
 
   if(!numLEDs) return;
 
+  // Nothing has changed since the last frame; the strip already shows it.
+  if(!dirty) {
+    skippedShows++;
+    return;
+  }
+  dirty = false;
+
+  uint8_t scale = outputScale(); // Brightness, power limited; 0 for none
+
+#if defined(__AVR__) || defined(__MK20DX128__)
   volatile uint16_t
-    i   = numBytes; // Loop counter
+    i;              // Loop counter
   volatile uint8_t
-   *ptr = pixels,   // Pointer to next byte
-    b   = *ptr++,   // Current byte value
+   *ptr;            // Pointer to next byte
+#endif
+#ifdef __AVR__
+  volatile uint8_t
+    b,              // Current byte value
     hi,             // PORT w/output bit set high
     lo;             // PORT w/output bit set low
+#endif
+  uint8_t
+   *next = &pixels[origin * 3], // Next pixel data to issue
+   *end  = &pixels[numBytes],   // Where it wraps around to pixel 0
+   *out  = wire;                // Where it goes in the frame
+  const uint8_t
+   *curve0 = curve[0],
+   *curve1 = curve[1],
+   *curve2 = curve[2];
+
+  // The pixel data is kept linear and at full brightness. The frame is
+  // built in 'wire' first, from the origin around to the pixel before it,
+  // with the output curves and then the output scale applied, so that it
+  // can then go out in one unbroken run. Doing that work between pixels
+  // would hold the line low for a few microseconds each time, which is
+  // enough for some WS2812 type parts to latch partway through a frame.
+  for(uint16_t n = numLEDs; n; n--) {
+    if(scale) { // See notes in setBrightness()
+      out[0] = (pgm_read_byte(&curve0[next[0]]) * scale) >> 8;
+      out[1] = (pgm_read_byte(&curve1[next[1]]) * scale) >> 8;
+      out[2] = (pgm_read_byte(&curve2[next[2]]) * scale) >> 8;
+    } else {
+      out[0] = pgm_read_byte(&curve0[next[0]]);
+      out[1] = pgm_read_byte(&curve1[next[1]]);
+      out[2] = pgm_read_byte(&curve2[next[2]]);
+    }
+    out  += 3;
+    next += 3;
+    if(next == end) next = pixels;
+  }
+#ifdef ORION_HOST
+  // No bitstream on the host; hand the bytes to the capture instead.
+  for(uint16_t n = 0; n < numBytes; n++)
+    hostWireWrite(wire[n]);
+#endif
 
   // Data latch = 50+ microsecond pause in the output stream.
   // Rather than put a delay at the end of the function, the ending
@@ -144,9 +322,31 @@ void WS2811::show(void) {
   // 'pin high' and 'pin low' values, and writes these back to the
   // PORT register as needed.
 
-  cli(); // Disable interrupts; need 100% focus on instruction timing
+#if defined(__AVR__) && (ARDUINO >= 100)
+  uint8_t timer0Start = TCNT0;
+#endif
 
+  if(hardwareSPI) {
+#ifdef WS2811_SPI
 #ifdef __AVR__
+    SPCR |= _BV(MSTR);
+#endif
+    // Given up on while SS is low; send the whole frame again next time.
+    if(!spiSend(wire, numBytes)) dirty = true;
+#endif
+  } else {
+
+  // Disable interrupts; need 100% focus on instruction timing
+  cli();
+
+#if defined(__AVR__) || defined(__MK20DX128__)
+  ptr = wire;
+  i   = numBytes;
+#endif
+
+#ifdef __AVR__
+
+  b = *ptr++;
 
 #if (F_CPU == 8000000UL) // FLORA, Lilypad, Arduino Pro 8 MHz, etc.
 
@@ -181,7 +381,7 @@ void WS2811::show(void) {
       // 64 words -- the maximum possible for a relative branch.
 
       asm volatile(
-       "headD:\n\t"         // Clk  Pseudocode
+       "headD%=:\n\t"         // Clk  Pseudocode
         // Bit 7:
         "out  %0, %1\n\t"   // 1    PORT = hi
         "mov  %3, %4\n\t"   // 1    n2   = lo
@@ -253,7 +453,7 @@ void WS2811::show(void) {
         "sbrc %5, 7\n\t"    // 1-2  if(b & 0x80)
          "mov %2, %1\n\t"   // 0-1    n1 = hi
         "out  %0, %4\n\t"   // 1    PORT = lo
-        "brne headD\n"      // 2    while(i) (zero flag determined above)
+        "brne headD%=\n"      // 2    while(i) (zero flag determined above)
         ::
         "I" (_SFR_IO_ADDR(PORTD)), // %0
         "r" (hi),                  // %1
@@ -273,7 +473,7 @@ void WS2811::show(void) {
       n1 = lo;
       if(b & 0x80) n1 = hi;
       asm volatile(
-       "headB:\n\t"
+       "headB%=:\n\t"
         "out  %0, %1\n\t"
         "mov  %3, %4\n\t"
         "out  %0, %2\n\t"
@@ -337,7 +537,7 @@ void WS2811::show(void) {
         "sbrc %5, 7\n\t"
          "mov %2, %1\n\t"
         "out  %0, %4\n\t"
-        "brne headB\n" :: "I" (_SFR_IO_ADDR(PORTB)), "r" (hi),
+        "brne headB%=\n" :: "I" (_SFR_IO_ADDR(PORTB)), "r" (hi),
           "r" (n1), "r" (n2), "r" (lo), "r" (b), "w" (i), "e" (ptr)
       ); // end asm
     } // endif PORTB
@@ -361,7 +561,7 @@ void WS2811::show(void) {
     bit  = 8;
 
     asm volatile(
-     "head40:\n\t"          // Clk  Pseudocode    (T =  0)
+     "head40%=:\n\t"          // Clk  Pseudocode    (T =  0)
       "st   %a0, %1\n\t"    // 2    PORT = hi     (T =  2)
       "sbrc %2, 7\n\t"      // 1-2  if(b & 128)
        "mov  %4, %1\n\t"    // 0-1   next = hi    (T =  4)
@@ -377,7 +577,7 @@ void WS2811::show(void) {
       "nop\n\t"             // 1    nop           (T = 23)
       "mov  %4, %5\n\t"     // 1    next = lo     (T = 24)
       "dec  %3\n\t"         // 1    bit--         (T = 25)
-      "breq nextbyte40\n\t" // 1-2  if(bit == 0)
+      "breq nextbyte40%=\n\t" // 1-2  if(bit == 0)
       "rol  %2\n\t"         // 1    b <<= 1       (T = 27)
       "nop\n\t"             // 1    nop           (T = 28)
       "mul  r0, r0\n\t"     // 2    nop nop       (T = 30)
@@ -385,15 +585,15 @@ void WS2811::show(void) {
       "st   %a0, %5\n\t"    // 2    PORT = lo     (T = 34)
       "mul  r0, r0\n\t"     // 2    nop nop       (T = 36)
       "mul  r0, r0\n\t"     // 2    nop nop       (T = 38)
-      "rjmp head40\n\t"     // 2    -> head40 (next bit out)
-     "nextbyte40:\n\t"      //                    (T = 27)
+      "rjmp head40%=\n\t"     // 2    -> head40 (next bit out)
+     "nextbyte40%=:\n\t"      //                    (T = 27)
       "ldi  %3, 8\n\t"      // 1    bit = 8       (T = 28)
       "ld   %2, %a6+\n\t"   // 2    b = *ptr++    (T = 30)
       "mul  r0, r0\n\t"     // 2    nop nop       (T = 32)
       "st   %a0, %5\n\t"    // 2    PORT = lo     (T = 34)
       "mul  r0, r0\n\t"     // 2    nop nop       (T = 36)
       "sbiw %7, 1\n\t"      // 2    i--           (T = 38)
-      "brne head40\n\t"     // 1-2  if(i != 0) -> head40 (next byte)
+      "brne head40%=\n\t"     // 1-2  if(i != 0) -> head40 (next byte)
       ::
       "e" (port),          // %a0
       "r" (hi),            // %1
@@ -441,14 +641,14 @@ void WS2811::show(void) {
     bit  = 8;
 
     asm volatile(
-     "head20:\n\t"          // Clk  Pseudocode    (T =  0)
+     "head20%=:\n\t"          // Clk  Pseudocode    (T =  0)
       "st   %a0, %1\n\t"    // 2    PORT = hi     (T =  2)
       "sbrc %2, 7\n\t"      // 1-2  if(b & 128)
        "mov  %4, %1\n\t"    // 0-1   next = hi    (T =  4)
       "st   %a0, %4\n\t"    // 2    PORT = next   (T =  6)
       "mov  %4, %5\n\t"     // 1    next = lo     (T =  7)
       "dec  %3\n\t"         // 1    bit--         (T =  8)
-      "breq nextbyte20\n\t" // 1-2  if(bit == 0)
+      "breq nextbyte20%=\n\t" // 1-2  if(bit == 0)
       "rol  %2\n\t"         // 1    b <<= 1       (T = 10)
 #ifdef __AVR_ATtiny85__
       "nop\n\t"             // 1 ea.
@@ -463,14 +663,14 @@ void WS2811::show(void) {
       "mul  r0, r0\n\t"     // 2    nop nop       (T = 16)
 #endif
       "st   %a0, %5\n\t"    // 2    PORT = lo     (T = 18)
-      "rjmp head20\n\t"     // 2    -> head20 (next bit out)
-     "nextbyte20:\n\t"      //                    (T = 10)
+      "rjmp head20%=\n\t"     // 2    -> head20 (next bit out)
+     "nextbyte20%=:\n\t"      //                    (T = 10)
       "nop\n\t"             // 1    nop           (T = 11)
       "ldi  %3, 8\n\t"      // 1    bit = 8       (T = 12)
       "ld   %2, %a6+\n\t"   // 2    b = *ptr++    (T = 14)
       "sbiw %7, 1\n\t"      // 2    i--           (T = 16)
       "st   %a0, %5\n\t"    // 2    PORT = lo     (T = 18)
-      "brne head20\n\t"     // 2    if(i != 0) -> head20 (next byte)
+      "brne head20%=\n\t"     // 2    if(i != 0) -> head20 (next byte)
       ::
       "e" (port),          // %a0
       "r" (hi),            // %1
@@ -517,8 +717,8 @@ void WS2811::show(void) {
 #elif F_CPU == 24000000
         #error "24 MHz not supported, use Tools > CPU Speed at 48 or 96 MHz"
 #endif
-	uint8_t *p   = pixels;
-	uint8_t *end = pixels + numBytes;
+	uint8_t *p   = (uint8_t *)ptr;
+	uint8_t *end = p + i;
 	volatile uint8_t *set = portSetRegister(pin);
 	volatile uint8_t *clr = portClearRegister(pin);
 	if ((type & NEO_SPDMASK) == NEO_KHZ800) { // 800 KHz bitstream
@@ -559,67 +759,120 @@ void WS2811::show(void) {
 
 #endif // __MK20DX128__ Teensy 3.0
 
-  sei();              // Re-enable interrupts
+  } // !hardwareSPI
+
+#ifdef ORION_HOST
+  hostWireLatch();
+#endif
+
+  if(!hardwareSPI) {
+#if defined(__AVR__) && (ARDUINO >= 100)
+    compensateTimer0(timer0Start, (uint32_t)numLEDs *
+      (((type & NEO_SPDMASK) == NEO_KHZ800) ? 30 : 60));
+#endif
+    sei();            // Re-enable interrupts
+  }
   endTime = micros(); // Note EOD time for latch on next call
 }
 
 
-// Set pixel color from separate R,G,B components:
-void WS2811::setPixelColor(
- uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
-  if(n < numLEDs) {
-      if(brightness) { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
-    uint8_t *p = &pixels[n * 3];
-    if((type & NEO_COLMASK) == NEO_GRB) { *p++ = g; *p++ = r; }
-    else                                { *p++ = r; *p++ = g; }
-    *p = b;
+// What a color byte drives its LED with at full brightness: its value
+// after the output curve. 'pos' is the byte's place within its pixel.
+inline uint8_t WS2811::drive(uint8_t c, uint8_t pos) {
+  return pgm_read_byte(&curve[pos][c]);
+}
+
+
+// Store one packed pixel, keeping channelSum and the dirty flag up to
+// date. 'n' must be in range.
+inline void WS2811::storePixel(uint16_t n, uint32_t c) {
+  uint8_t
+    *p     = &pixels[n * 3],
+    first  = (uint8_t)(c >> 16),
+    second = (uint8_t)(c >>  8),
+    third  = (uint8_t)c;
+  if(p[0] != first || p[1] != second || p[2] != third) {
+    // See LPD8806::storePixel(): two steps, or a dimmer pixel wraps on AVR.
+    channelSum += (uint16_t)(drive(first, 0) + drive(second, 1) + drive(third, 2));
+    channelSum -= (uint16_t)(drive(p[0], 0) + drive(p[1], 1) + drive(p[2], 2));
+    p[0] = first;
+    p[1] = second;
+    p[2] = third;
+    dirty = true;
   }
 }
 
 
-// Set pixel color from 'packed' 32-bit RGB color:
+// Set pixel color from a color packed in the strip's own byte order (GRB
+// or RGB, as set by 'type'); PixelFormat<8, ...> in strip.h packs these.
 void WS2811::setPixelColor(uint16_t n, uint32_t c) {
-  if(n < numLEDs) {
-      uint8_t
-      r = (uint8_t)(c >> 16),
-      g = (uint8_t)(c >>  8),
-      b = (uint8_t)c;
-    if(brightness) 
-    { // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
-    uint8_t *p = &pixels[n * 3];
-    if((type & NEO_COLMASK) == NEO_GRB) { *p++ = g; *p++ = r; }
-    else                                { *p++ = r; *p++ = g; }
-    *p = b;
+#ifdef ORION_HOST
+  hostTrace.setPixelCalls++;
+#endif
+  if(n < numLEDs)
+    storePixel(n, c);
+}
+
+
+// Set 'count' pixels from 'start' on to one packed color, as taken by
+// setPixelColor(). Pixels past the end of the strip are left out.
+void WS2811::fill(uint16_t start, uint16_t count, uint32_t c) {
+  if(start >= numLEDs) return;
+  if(count > numLEDs - start) count = numLEDs - start;
+
+  for(uint16_t n = start; n < start + count; n++)
+    storePixel(n, c);
+}
+
+
+// Set 'count' pixels from 'start' on to packed colors from 'colors'.
+// Pixels past the end of the strip are left out.
+void WS2811::setPixels(uint16_t start, const uint32_t *colors, uint16_t count) {
+  if(start >= numLEDs) return;
+  if(count > numLEDs - start) count = numLEDs - start;
+
+  for(uint16_t n = start; n < start + count; n++)
+    storePixel(n, *colors++);
+}
+
+
+uint8_t *WS2811::getPixels(void) {
+  return pixels;
+}
+
+
+// Pixels were written directly: recount them and send them all.
+void WS2811::pixelsChanged(void) {
+  channelSum = 0;
+  for(uint16_t i = 0; i < numBytes; i += 3)
+    channelSum += (uint16_t)drive(pixels[i], 0) + drive(pixels[i + 1], 1) +
+                            drive(pixels[i + 2], 2);
+  dirty = true;
+}
+
+
+// Have show() send pixel 'n' to the first LED of the strip and wrap around
+// to pixel 0 after the last one. See LPD8806::setOrigin().
+void WS2811::setOrigin(uint16_t n) {
+  if(n >= numLEDs) n = numLEDs ? n % numLEDs : 0;
+  if(n != origin) {
+    origin = n;
+    dirty  = true;
   }
 }
 
 
-// Convert separate R,G,B into packed 32-bit RGB color.
-// Packed format is always RGB, regardless of LED strand color order.
-uint32_t WS2811::Color(uint8_t r, uint8_t g, uint8_t b) {
-  return ((uint32_t)r << 16) | ((uint32_t)g <<  8) | b;
+uint16_t WS2811::getOrigin(void) {
+  return origin;
 }
 
-// Query color from previously-set pixel (returns packed 32-bit RGB value)
-uint32_t WS2811::getPixelColor(uint16_t n) {
 
+// Query color from previously-set pixel (returns the packed color, in
+// the strip's own byte order)
+uint32_t WS2811::getPixelColor(uint16_t n) {
   if(n < numLEDs) {
     uint16_t ofs = n * 3;
-    return (uint32_t)(pixels[ofs + 2]) |
-      (((type & NEO_COLMASK) == NEO_GRB) ?
-        ((uint32_t)(pixels[ofs    ]) <<  8) |
-        ((uint32_t)(pixels[ofs + 1]) << 16)
-      :
-        ((uint32_t)(pixels[ofs    ]) << 16) |
-        ((uint32_t)(pixels[ofs + 1]) <<  8) );
+    return ((uint32_t)pixels[ofs] << 16) | ((uint32_t)pixels[ofs + 1] << 8) | pixels[ofs + 2];
   }
 
   return 0; // Pixel # is out of bounds
@@ -629,6 +882,11 @@ uint16_t WS2811::numPixels(void) {
   return numLEDs;
 }
 
+// Number of show() calls that sent nothing because no pixel had changed.
+uint32_t WS2811::getSkippedShows(void) {
+  return skippedShows;
+}
+
 
 void WS2811::setBrightness(uint8_t b) {
   // Stored brightness value is different than what's passed.
@@ -638,21 +896,38 @@ void WS2811::setBrightness(uint8_t b) {
   // (color values are interpreted literally; no scaling), 1 = min
   // brightness (off), 255 = just below max brightness.
   uint8_t newBrightness = b + 1;
-  if(newBrightness != brightness) 
-  { // Compare against prior value
-    // Brightness has changed -- re-scale existing data in RAM
-    uint8_t  c,
-            *ptr           = pixels,
-             oldBrightness = brightness - 1; // De-wrap old brightness value
-    uint16_t scale;
-    if(oldBrightness == 0) scale = 0; // Avoid /0
-    else if(b == 255) scale = 65535 / oldBrightness;
-    else scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
-    for(uint16_t i=0; i<numBytes; i++) {
-      c      = *ptr;
-      *ptr++ = (c * scale) >> 8;
-    }
+
+  // The pixel data is kept at full brightness and only scaled as it is
+  // issued, so all a change needs is a redraw on the next show().
+  if(newBrightness != brightness) { // Compare against prior value
     brightness = newBrightness;
+    dirty      = true;
   }
 }
 
+// Cap the power drawn by the strip: 'limit' is the largest sum of the
+// drive of all the channels (0-255 each, after the output curves) that may
+// be shown at once (0 for no limit). Frames that would go over it are
+// dimmed as they are sent until they fit.
+void WS2811::setPowerLimit(uint32_t limit) {
+  if(limit != powerLimit) {
+    powerLimit = limit;
+    dirty      = true;
+  }
+}
+
+// The scale show() applies: the brightness, lowered further if the frame
+// would otherwise go over the power limit. The channel sum is of the
+// values after the output curves, what the LEDs are actually driven with,
+// and the brightness scales that linearly. Same encoding as 'brightness'.
+uint8_t WS2811::outputScale(void) {
+  if(!powerLimit)
+    return brightness;
+
+  uint32_t drawn = brightness ? (channelSum * brightness) >> 8 : channelSum;
+  if(drawn <= powerLimit)
+    return brightness;
+
+  uint8_t scale = (powerLimit << 8) / channelSum; // < brightness here
+  return scale ? scale : 1;                       // 0 would mean full
+}
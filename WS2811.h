@@ -16,6 +16,9 @@
   <http://www.gnu.org/licenses/>.
   --------------------------------------------------------------------*/
 
+#ifndef __WS2811_H
+#define __WS2811_H
+
 #if (ARDUINO >= 100)
  #include <Arduino.h>
 #else
@@ -30,6 +33,7 @@
 #define NEO_KHZ400  0x00 // 400 KHz datastream
 #define NEO_KHZ800  0x02 // 800 KHz datastream
 #define NEO_SPDMASK 0x02
+#define NEO_SPI     0x04 // Send through the SPI peripheral on MOSI (AVR only)
 
 class WS2811 {
 
@@ -37,44 +41,78 @@ class WS2811 {
 
   // Constructor: number of LEDs, pin number, LED type
   WS2811(uint16_t n, uint8_t p=6, uint8_t t=NEO_GRB + NEO_KHZ800);
+  // As above, with the pixels in 'buf', bufferBytes(n) bytes of the
+  // caller's memory, instead of memory allocated here.
+  WS2811(uint8_t *buf, uint16_t n, uint8_t p=6, uint8_t t=NEO_GRB + NEO_KHZ800);
   WS2811(void); // Empty constructor; init pins & strip length later
 
   void
     begin(void),
     show(void),
-    setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
     setPixelColor(uint16_t n, uint32_t c),
+    fill(uint16_t start, uint16_t count, uint32_t c), // Set a run of pixels to one color
+    setPixels(uint16_t start, const uint32_t *colors, uint16_t count), // Set a run of pixels from an array
+    pixelsChanged(void), // Call after writing through getPixels()
+    setOrigin(uint16_t n), // Pixel that show() sends first
     enable(boolean setBegun),  // Power up, activate SPI
     disable(void),             // Power down, disable SPI
-    setBrightness(uint8_t);
+    setBrightness(uint8_t),
+    setPowerLimit(uint32_t limit);
 
     boolean isEnabled(void);   // 
     boolean isDisabled(void);  // 
   uint16_t
-    numPixels(void);
+    numPixels(void),
+    getOrigin(void);
+  // Bytes of memory the strip needs for 'n' pixels, for 'buf' above: the
+  // pixels, and the frame show() builds from them to send.
+  static constexpr uint16_t bufferBytes(uint16_t n) {
+    return 2 * n * 3;
+  }
+  // The pixel data itself, 3 bytes per pixel in the strip's color order.
+  // Nothing is checked; call pixelsChanged() when done.
+  uint8_t
+    *getPixels(void);
   uint32_t
-    Color(uint8_t r, uint8_t g, uint8_t b),
-    getPixelColor(uint16_t n);
+    getPixelColor(uint16_t n),
+    getSkippedShows(void);
 
  private:
 
   uint16_t
     numLEDs,       // Number of RGB LEDs in strip
-    numBytes;      // Size of 'pixels' buffer below
+    numBytes,      // Size of 'pixels' buffer below
+    origin;        // Pixel sent first by show(), see setOrigin()
   uint8_t
    *pixels,        // Holds LED color values (3 bytes each)
+   *wire,          // The frame as it goes out, see show()
     brightness,    // Global brightness
     pin,           // Output pin number
     pinMask,       // Output PORT bitmask
     type;          // Pixel flags (400 vs 800 KHz, RGB vs GRB color)
   volatile uint8_t
     *port;         // Output PORT register
+  const uint8_t
+    *curve[3];     // Output curve of each byte of a pixel, in 'type' order
   uint32_t
-    endTime;       // Latch timing reference
+    endTime,       // Latch timing reference
+    skippedShows,  // show() calls with nothing to send
+    channelSum,    // Sum of the drive of all channels in 'pixels', see drive()
+    powerLimit;    // Largest channelSum to show unscaled, 0 for no limit
+  uint8_t
+    drive(uint8_t c, uint8_t pos),
+    outputScale(void);
+  void
+    init(uint16_t n, uint8_t p, uint8_t t, uint8_t *buf),
+    startSPI(void),
+    storePixel(uint16_t n, uint32_t c);
   boolean
+    dirty,       // If 'true', pixels changed since the last show()
     hardwareSPI, // If 'true', using hardware SPI
     begun,       // If 'true', begin() method was previously invoked
     enabled;     // If 'true', power up the strip and allow data push, else power down
 
 
 };
+
+#endif
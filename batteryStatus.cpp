@@ -1,9 +1,14 @@
 #include "batteryStatus.h"
 #include "pins.h"
 
-boolean __refreshBatteryStatus; // Interrupt semaphore for updating the battery status.
+volatile boolean __refreshBatteryStatus; // Set by the ADC interrupt when a new reading is ready.
+volatile uint16_t __batteryMillivolts;   // Last battery reading, 0 until the first one.
 
-// initialize Timer1 for use in controlling battery status update
+// Conversions summed into one reading.
+static uint8_t  sampleCount;
+static uint16_t sampleSum;
+
+// initialize Timer1 and the ADC to sample the battery voltage in the background
 void setupBatteryStatusInterrupt(void) {
   // First disable global interrupts during setup.
   cli();
@@ -13,25 +18,89 @@ void setupBatteryStatusInterrupt(void) {
  
   // Set compare match register to desired timer count:
   OCR1A = 3624;
+  // Compare B at the same count starts the ADC at the end of each period.
+  OCR1B = OCR1A;
   // Turn on CTC mode:
   TCCR1B |= (1 << WGM12);
   // Set CS10 and CS12 bits for 1024 prescaler:
   TCCR1B |= (1 << CS10);
   TCCR1B |= (1 << CS12);
-  // Enable timer compare interrupt:
-  TIMSK1 |= (1 << OCIE1A);
+  TIFR1 = (1 << OCF1B);
+
+  // 2.56 V reference on the voltage sense pin.
+#ifdef analogPinToChannel
+  uint8_t channel = analogPinToChannel(PIN_V_SENSE);
+#else
+  uint8_t channel = PIN_V_SENSE;
+#endif
+  ADMUX  = (1 << REFS1) | (1 << REFS0) | (channel & 0x07);
+  // Triggered by Timer1 compare B.
+  ADCSRB = (channel & 0x08 ? (1 << MUX5) : 0) | (1 << ADTS2) | (1 << ADTS0);
+  // Enabled, auto triggered, interrupting, at F_CPU/128 (about 104 us a conversion).
+  ADCSRA = (1 << ADEN) | (1 << ADATE) | (1 << ADIE) |
+           (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+  sampleCount = 0;
+  sampleSum   = 0;
+
   // Now that we are finished, renable global interrupts
   sei();
 } // setupBatteryStatusInterrupt()
 
 
-ISR(TIMER1_COMPA_vect) {
-  // Set a semaphore so the main loop can update the battery status.
-  // This keeps the interrupt small and fast.
+// Each Timer1 period the trigger starts a burst of BATTERY_SAMPLES
+// conversions, each started from here as the previous one completes.
+// Their average becomes the new reading and the main loop is told.
+ISR(ADC_vect) {
+  sampleSum += ADC;
+
+  if(++sampleCount < BATTERY_SAMPLES) {
+    ADCSRA |= (1 << ADSC);
+    return;
+  }
+
+  // The voltage sense divider and 2.56 V reference give 5 mV per count.
+  __batteryMillivolts    = (uint32_t)sampleSum * 5 / BATTERY_SAMPLES;
   __refreshBatteryStatus = true;
+  sampleCount = 0;
+  sampleSum   = 0;
+
+  // Nothing else clears compare B, and the ADC only starts on its rising edge.
+  TIFR1 = (1 << OCF1B);
 } // ISR()
 
 
+// Status LED colours, for setStatusLight().
+#define STATUS_OFF   0
+#define STATUS_RED   1
+#define STATUS_GREEN 2
+#define STATUS_BLUE  4
+
+// Red and green share PORTB, so they change together in one write; blue is on PORTC.
+static void setStatusLight(uint8_t color) {
+  static_assert(LedRedPin::port == LedGreenPin::port, "red and green are written together");
+
+  // LOW is on.
+  writePort<LedRedPin::port>(LedRedPin::mask | LedGreenPin::mask,
+                             (color & STATUS_RED   ? 0 : LedRedPin::mask) |
+                             (color & STATUS_GREEN ? 0 : LedGreenPin::mask));
+  if(color & STATUS_BLUE)
+    LedBluePin::low();
+  else
+    LedBluePin::high();
+} // setStatusLight()
+
+
+// True if 'millivolts' is below 'threshold'. Once below, it has to climb
+// BATTERY_HYSTERESIS_MILLIVOLTS past the threshold before it counts as
+// above again, so a reading hovering at a threshold doesn't flicker the LED.
+static boolean below(uint16_t millivolts, uint16_t threshold, boolean &wasBelow) {
+  if(wasBelow)
+    threshold += BATTERY_HYSTERESIS_MILLIVOLTS;
+  wasBelow = millivolts < threshold;
+  return wasBelow;
+} // below()
+
+
 void updateBatteryStatus(boolean isUnitPowered) {
 
 //    digitalWrite(PIN_LED_GREEN, HIGH);
@@ -45,48 +114,29 @@ void updateBatteryStatus(boolean isUnitPowered) {
   __refreshBatteryStatus = false;
 
   
-  // @todo DOC
-  float batteryVoltage = analogRead(PIN_V_SENSE)*0.005;
+  uint16_t batteryVoltage = batteryMillivolts();
+  static boolean belowCharged, belowEmpty, belowHalf;
 
-  // Turn all the LEDs off, this is the default state.
-  digitalWrite(PIN_LED_GREEN, HIGH);
-  digitalWrite(PIN_LED_RED  , HIGH);
-  digitalWrite(PIN_LED_BLUE , HIGH);
-  
   // USB power detection
   // When charging LED is purple. When fully charged LED is white.
   if(!(UDINT & B00000001))
   {
-    if(batteryVoltage < 4.0)
-    {
-      //digitalWrite(PIN_LED_GREEN, LOW);
-      digitalWrite(PIN_LED_RED  , LOW);
-      digitalWrite(PIN_LED_BLUE , LOW); 
-      return;
-    } else {
-        // Flashing white
-      digitalWrite(PIN_LED_GREEN, LOW);
-      digitalWrite(PIN_LED_RED  , LOW);
-      digitalWrite(PIN_LED_BLUE , LOW); 
-      return;
-    }
+    if(below(batteryVoltage, BATTERY_CHARGED_MILLIVOLTS, belowCharged))
+      setStatusLight(STATUS_RED | STATUS_BLUE);
+    else
+      setStatusLight(STATUS_RED | STATUS_GREEN | STATUS_BLUE);
+    return;
   }
   
   // If the unit is powered off, then don't turn on any leds as this wastes battery power.
   if(!isUnitPowered)
-    return;
-    
-  if(batteryVoltage < 3.0) {
-    digitalWrite(PIN_LED_RED, LOW);
-    return;
-  }
-  
-  if(batteryVoltage < 3.5) {
-    digitalWrite(PIN_LED_BLUE, LOW);
-    return;
-  }
-
-  digitalWrite(PIN_LED_GREEN, LOW);
+    setStatusLight(STATUS_OFF);
+  else if(below(batteryVoltage, BATTERY_EMPTY_MILLIVOLTS, belowEmpty))
+    setStatusLight(STATUS_RED);
+  else if(below(batteryVoltage, BATTERY_HALF_MILLIVOLTS, belowHalf))
+    setStatusLight(STATUS_BLUE);
+  else
+    setStatusLight(STATUS_GREEN);
   
   
   // If fully charged or charging turn on all the LEDs (white) 
@@ -102,11 +152,20 @@ void updateBatteryStatus(boolean isUnitPowered) {
 //  }
 } // updateBatteryStatus()
 
+// Battery voltage as of the last update, in millivolts (0 if not read yet).
+uint16_t batteryMillivolts(void) {
+  // Two bytes written by the ADC interrupt. Restore the interrupt flag
+  // rather than setting it, as this may be called with interrupts off.
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t millivolts = __batteryMillivolts;
+  SREG = oldSREG;
+  return millivolts;
+} // batteryMillivolts()
+
+
 void forceStatusLightOff() {
-    // Turn all the LEDs off, this is the default state.
-  digitalWrite(PIN_LED_GREEN, HIGH);
-  digitalWrite(PIN_LED_RED  , HIGH);
-  digitalWrite(PIN_LED_BLUE , HIGH);
+  setStatusLight(STATUS_OFF);
 }
 // End of file.
 
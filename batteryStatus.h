@@ -3,9 +3,21 @@
 
 #include <Arduino.h>
 
+// The battery voltage is sampled by the ADC in the background: Timer1 sets
+// off a burst of BATTERY_SAMPLES conversions about four times a second,
+// and their average is the reading updateBatteryStatus() shows.
+#define BATTERY_SAMPLES 16 // At most 64
+
+// Status LED thresholds.
+#define BATTERY_CHARGED_MILLIVOLTS   4000 // On USB: purple below, white above
+#define BATTERY_HALF_MILLIVOLTS      3500 // Blue below, green above
+#define BATTERY_EMPTY_MILLIVOLTS     3000 // Red below
+#define BATTERY_HYSTERESIS_MILLIVOLTS  50
+
 void setupBatteryStatusInterrupt(void);
 void updateBatteryStatus(boolean isUnitPowered);
 void forceStatusLightOff();
+uint16_t batteryMillivolts(void);
 
 #endif
 
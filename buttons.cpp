@@ -0,0 +1,87 @@
+#include <avr/interrupt.h>
+#include "buttons.h"
+#include "pins.h"
+
+volatile uint8_t __buttonQueueHead; // Next slot to fill, moved by the sampling interrupt only
+volatile uint8_t __buttonQueueTail; // Next slot to take, moved by takeButtonEvent() only
+static ButtonEvent queue[BUTTON_QUEUE_SIZE];
+
+// The last 16 samples of each button, newest in bit 0, 1 = HIGH.
+static uint16_t history[4];
+
+// Keeps the compiler from moving queue slot accesses across the index
+// updates that hand the slot over to the other side.
+#define QUEUE_BARRIER() asm volatile("" ::: "memory")
+
+// BUTTON_DEBOUNCE_MS samples HIGH, preceded by one LOW.
+#define DEBOUNCE_MASK  ((2U << BUTTON_DEBOUNCE_MS) - 1)
+#define DEBOUNCE_MATCH ((1U << BUTTON_DEBOUNCE_MS) - 1)
+
+void setupButtons(void) {
+  // Start out as if every button had long been released.
+  for(uint8_t i = 0; i < 4; i++)
+    history[i] = 0xFFFF;
+  __buttonQueueHead = __buttonQueueTail = 0;
+
+  // Timer0 is already running for millis(); interrupt halfway through
+  // each of its cycles as well.
+  OCR0A   = 0x80;
+  TIMSK0 |= (1 << OCIE0A);
+} // setupButtons()
+
+
+boolean takeButtonEvent(ButtonEvent &event) {
+  uint8_t tail = __buttonQueueTail;
+
+  if(tail == __buttonQueueHead)
+    return false;
+
+  // The slot is copied out before it is handed back to the interrupt.
+  event = queue[tail];
+  QUEUE_BARRIER();
+  __buttonQueueTail = (tail + 1) & (BUTTON_QUEUE_SIZE - 1);
+  return true;
+} // takeButtonEvent()
+
+
+void pressButton(uint8_t button) {
+  for(uint8_t i = 0; i < 4; i++)
+    if(button & (1 << i))
+      history[i] &= ~1;
+} // pressButton()
+
+
+boolean buttonsSettling(void) {
+  boolean settling = false;
+  uint8_t oldSREG = SREG;
+  cli(); // The history is two bytes, written by the interrupt.
+  for(uint8_t i = 0; i < 4; i++)
+    if((history[i] & DEBOUNCE_MATCH) != DEBOUNCE_MATCH)
+      settling = true;
+  SREG = oldSREG;
+  return settling;
+} // buttonsSettling()
+
+
+ISR(TIMER0_COMPA_vect) {
+  uint8_t levels = (ButtonModePin::read()  ? BUTTON_MODE  : 0) |
+                   (ButtonSpeedPin::read() ? BUTTON_SPEED : 0) |
+                   (ButtonLevelPin::read() ? BUTTON_LEVEL : 0) |
+                   (ButtonPowerPin::read() ? BUTTON_POWER : 0);
+
+  for(uint8_t i = 0; i < 4; i++) {
+    history[i] = (history[i] << 1) | ((levels >> i) & 1);
+    if((history[i] & DEBOUNCE_MASK) == DEBOUNCE_MATCH) {
+      uint8_t head = __buttonQueueHead;
+      uint8_t next = (head + 1) & (BUTTON_QUEUE_SIZE - 1);
+      if(next != __buttonQueueTail) {
+        queue[head].button = 1 << i;
+        queue[head].micros = micros();
+        QUEUE_BARRIER();
+        __buttonQueueHead  = next;
+      }
+    }
+  }
+} // ISR()
+
+// End of file.
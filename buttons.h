@@ -0,0 +1,59 @@
+#ifndef __SYNTHESIA_BUTTONS_H
+#define __SYNTHESIA_BUTTONS_H
+
+#include <Arduino.h>
+
+// Debounced buttons. The Timer0 compare A interrupt samples all four
+// buttons once a millisecond (Timer0 also keeps millis(); compare A is
+// otherwise unused). A button that has read LOW and then reads HIGH for
+// BUTTON_DEBOUNCE_MS samples in a row queues an event, once, so the
+// response is the same whatever the main loop is doing.
+//
+// The queue is a ring buffer with one writer, the interrupt, which only
+// moves the head, and one reader, the main loop, which only moves the
+// tail. Both indices are single bytes, so neither side needs to mask
+// interrupts. A full queue drops the newest event.
+#ifndef BUTTON_DEBOUNCE_MS
+#define BUTTON_DEBOUNCE_MS 10 // At most 15
+#endif
+
+// Button event bits.
+#define BUTTON_MODE  0x01
+#define BUTTON_SPEED 0x02
+#define BUTTON_LEVEL 0x04
+#define BUTTON_POWER 0x08
+
+#define BUTTON_QUEUE_SIZE 8 // A power of two
+
+struct ButtonEvent {
+  uint8_t button;      // One of the event bits above
+  unsigned long micros; // micros() when the press was recognised
+};
+
+extern volatile uint8_t __buttonQueueHead, __buttonQueueTail;
+
+void setupButtons(void);
+
+// Takes the oldest event off the queue into 'event'. Returns false if
+// the queue is empty.
+boolean takeButtonEvent(ButtonEvent &event);
+
+// True if any button event is waiting to be taken.
+inline boolean buttonEventPending(void) {
+  return __buttonQueueHead != __buttonQueueTail;
+}
+
+// Counts 'button' (event bits) as having read LOW just now, for a press
+// the sampling could not see: one that woke the CPU from power down, where
+// Timer0 is stopped. The release is then debounced as usual. Call from an
+// interrupt or with interrupts off.
+void pressButton(uint8_t button);
+
+// True while any button reads LOW or has not yet read HIGH for
+// BUTTON_DEBOUNCE_MS samples, so that an event may still come of it. The
+// CPU must not power down then, or the sampling stops before it does.
+boolean buttonsSettling(void);
+
+#endif
+
+// End of file.
@@ -1,45 +1,49 @@
-// Gamma correction code and values developed by Jason Clark https://github.com/elmerfud
+// Gamma correction originally developed by Jason Clark https://github.com/elmerfud
 // Gamma correction compensates for our eyes' nonlinear perception of
-// intensity.  It's the LAST step before a pixel value is stored, and
-// allows intermediate rendering/processing to occur in linear space.
-// The table contains 256 elements (8 bit input), though the outputs are
-// only 7 bits (0 to 127).  This is normal and intentional by design: it
-// allows all the rendering code to operate in the more familiar unsigned
-// 8-bit colorspace (used in a lot of existing graphics code), and better
-// preserves accuracy where repeated color blending operations occur.
-// Only the final end product is converted to 7 bits, the native format
-// for the LPD8806 LED driver.  Gamma correction and 7-bit decimation
-// thus occur in a single operation.
+// intensity.  It's the LAST step before a value goes out to the strip,
+// and allows all the rendering/processing to occur in linear space.
+// The tables are generated by the compiler, one curve per channel in the
+// native depth of each driver, with the white balance folded in.
 #include "gamma.h"
 
-PROGMEM prog_uchar __gammaTable[]  = {
-    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,
-    1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  2,  2,  2,  2,
-    2,  2,  2,  2,  2,  3,  3,  3,  3,  3,  3,  3,  3,  4,  4,  4,
-    4,  4,  4,  4,  5,  5,  5,  5,  5,  6,  6,  6,  6,  6,  7,  7,
-    7,  7,  7,  8,  8,  8,  8,  9,  9,  9,  9, 10, 10, 10, 10, 11,
-   11, 11, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 15, 15, 16, 16,
-   16, 17, 17, 17, 18, 18, 18, 19, 19, 20, 20, 21, 21, 21, 22, 22,
-   23, 23, 24, 24, 24, 25, 25, 26, 26, 27, 27, 28, 28, 29, 29, 30,
-   30, 31, 32, 32, 33, 33, 34, 34, 35, 35, 36, 37, 37, 38, 38, 39,
-   40, 40, 41, 41, 42, 43, 43, 44, 45, 45, 46, 47, 47, 48, 49, 50,
-   50, 51, 52, 52, 53, 54, 55, 55, 56, 57, 58, 58, 59, 60, 61, 62,
-   62, 63, 64, 65, 66, 67, 67, 68, 69, 70, 71, 72, 73, 74, 74, 75,
-   76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91,
-   92, 93, 94, 95, 96, 97, 98, 99,100,101,102,104,105,106,107,108,
-  109,110,111,113,114,115,116,117,118,120,121,122,123,125,126,127
+// Integer square root, rounded down, by bisection of [lo, hi].
+constexpr uint16_t gammaSqrt(uint64_t n, uint16_t lo, uint16_t hi) {
+  return lo == hi ? lo
+       : (uint64_t)((lo + hi + 1) / 2) * ((lo + hi + 1) / 2) <= n
+           ? gammaSqrt(n, (lo + hi + 1) / 2, hi)
+           : gammaSqrt(n, lo, (lo + hi + 1) / 2 - 1);
+}
+
+// white * (x / top)^2.5 * top / 255, rounded. Squaring both sides leaves
+// x^5 * white^2 / (top^3 * 255^2); the root is taken of four times that
+// to get one extra bit for the rounding.
+constexpr uint8_t gammaEntry(uint8_t x, uint8_t top, uint8_t white) {
+  return (gammaSqrt((uint64_t)x * x * x * x * x * white * white * 4 /
+                    ((uint64_t)top * top * top * 255 * 255), 0, 511) + 1) / 2;
+}
+
+#define GAMMA_1(x, t, w)   gammaEntry(x, t, w),
+#define GAMMA_4(x, t, w)   GAMMA_1(x, t, w)       GAMMA_1(x + 1, t, w) \
+                           GAMMA_1(x + 2, t, w)   GAMMA_1(x + 3, t, w)
+#define GAMMA_16(x, t, w)  GAMMA_4(x, t, w)       GAMMA_4(x + 4, t, w) \
+                           GAMMA_4(x + 8, t, w)   GAMMA_4(x + 12, t, w)
+#define GAMMA_64(x, t, w)  GAMMA_16(x, t, w)      GAMMA_16(x + 16, t, w) \
+                           GAMMA_16(x + 32, t, w) GAMMA_16(x + 48, t, w)
+#define GAMMA_128(x, t, w) GAMMA_64(x, t, w)      GAMMA_64(x + 64, t, w)
+
+#define GAMMA7(w) { GAMMA_128(0, 127, w) }
+#define GAMMA8(w) { GAMMA_128(0, 255, w) GAMMA_128(128, 255, w) }
+
+const uint8_t __gamma7[3][128] PROGMEM = {
+  GAMMA7(GAMMA_WHITE_RED), GAMMA7(GAMMA_WHITE_GREEN), GAMMA7(GAMMA_WHITE_BLUE)
 };
 
+const uint8_t __gamma8[3][256] PROGMEM = {
+  GAMMA8(GAMMA_WHITE_RED), GAMMA8(GAMMA_WHITE_GREEN), GAMMA8(GAMMA_WHITE_BLUE)
+};
 
-// This function (which actually gets 'inlined' anywhere it's called)
-// exists so that gammaTable can reside out of the way down here in the
-// utility code...didn't want that huge table distracting or intimidating
-// folks before even getting into the real substance of the program, and
-// the compiler permits forward references to functions but not data.
-byte gamma(byte x) {
-  return pgm_read_byte(&__gammaTable[x*2 + 2]);
-} // gamma()
+static_assert(gammaEntry(127, 127, 255) == 127 &&
+              gammaEntry(255, 255, 255) == 255,
+              "Gamma curve does not reach full scale");
 
 // End of file.
-
@@ -3,9 +3,35 @@
 
 #include <Arduino.h>
 
-byte gamma(byte x);
+// Output curves used by the strip drivers. Every color byte goes through
+// one of these as it is sent, so the modes render in linear space and all
+// of them get the same correction. Each curve is a 2.5 power-law gamma,
+// scaled to that channel's white point below.
 
+// Relative drive of each channel at full white (255 = full). The green
+// and blue dies of typical 5050 LEDs are brighter than the red one, so
+// those two are trimmed to get a neutral white.
+#ifndef GAMMA_WHITE_RED
+ #define GAMMA_WHITE_RED   255
+#endif
+#ifndef GAMMA_WHITE_GREEN
+ #define GAMMA_WHITE_GREEN 176
+#endif
+#ifndef GAMMA_WHITE_BLUE
+ #define GAMMA_WHITE_BLUE  240
 #endif
 
-// End of file.
+// Curve index for each channel.
+#define GAMMA_RED   0
+#define GAMMA_GREEN 1
+#define GAMMA_BLUE  2
+
+// 7-bit in, 7-bit out, for the LPD8806.
+extern const uint8_t __gamma7[3][128] PROGMEM;
 
+// 8-bit in, 8-bit out, for the WS2811.
+extern const uint8_t __gamma8[3][256] PROGMEM;
+
+#endif
+
+// End of file.
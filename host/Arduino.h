@@ -0,0 +1,156 @@
+#ifndef __HOST_ARDUINO_H
+#define __HOST_ARDUINO_H
+
+/*
+ Host-side stand-in for the Arduino core so the Orion modes and LED drivers
+ can be compiled and exercised on a Linux machine (see host/Makefile).
+
+ Time is virtual: the benchmark advances it explicitly with hostAdvanceMicros(),
+ and every micros() read ticks it forward by one microsecond so that spin
+ loops on micros() (e.g. the WS2811 latch wait) always terminate.
+ Everything the drivers push out through SPI.transfer() or hostWireWrite()
+ is captured so that the output of a mode can be counted and fingerprinted.
+ The captured stream also drives a model of the strip itself (LPD8806
+ latching or WS2811 shift-through, after LED_TYPE), so that what the LEDs
+ would actually show can be fingerprinted separately from the wire traffic.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define PI 3.1415926535897932384626433832795
+
+#define B00000001 1
+
+// Leonardo (32U4) pin numbers used by the sketch.
+#define MOSI 16
+#define SCK  15
+#define A5   23
+
+#define INTERNAL 3
+#define DEFAULT  1
+
+// 32U4 registers touched by the sketch. They are plain memory on the host.
+extern volatile uint8_t  TCCR1A, TCCR1B, TIMSK1, TIFR1, UDINT, TCCR3A, TCCR3B, TIMSK0, OCR0A;
+extern volatile uint8_t  ADMUX, ADCSRA, ADCSRB, SREG;
+extern volatile uint16_t OCR1A, OCR1B, TCNT3, ADC;
+
+#define WGM12  3
+#define CS10   0
+#define CS12   2
+#define OCIE1A 1
+#define OCIE0A 1
+#define OCF1B  2
+#define REFS1  7
+#define REFS0  6
+#define ADEN   7
+#define ADSC   6
+#define ADATE  5
+#define ADIE   3
+#define ADPS2  2
+#define ADPS1  1
+#define ADPS0  0
+#define MUX5   5
+#define ADTS2  2
+#define ADTS0  0
+#define CS30   0
+#define CS31   1
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+// USB serial port. Output goes to stdout; nothing is ever received.
+class HostSerial {
+ public:
+  void begin(unsigned long baud) {}
+  int  available(void) { return 0; }
+  int  read(void)      { return -1; }
+  void print(const char *s);
+  void print(char c);
+  void print(unsigned int n)  { print((unsigned long)n); }
+  void print(unsigned long n);
+  void println(void);
+  void println(const char *s);
+  void println(unsigned int n) { println((unsigned long)n); }
+  void println(unsigned long n);
+};
+
+extern HostSerial Serial;
+
+#define interrupts()   sei()
+#define noInterrupts() cli()
+
+// Every pin maps onto one fake PORT register; good enough for the drivers,
+// which only take its address.
+extern volatile uint8_t hostPort;
+#define digitalPinToPort(p)    ((p) / 8)
+#define digitalPinToBitMask(p) ((uint8_t)(1 << ((p) % 8)))
+#define portOutputRegister(p)  (&hostPort)
+
+// The I/O registers, by data space address, for the port bit access in pins.h.
+extern volatile uint8_t hostRegisters[0x60];
+#define _MMIO_BYTE(address) (hostRegisters[address])
+
+// Host-only instrumentation, bumped by the drivers when built with ORION_HOST.
+struct HostTrace {
+  uint32_t setPixelCalls; // LPD8806/WS2811 setPixelColor() calls
+  uint32_t showCalls;     // LPD8806/WS2811 show() calls
+  uint32_t wireBytes;     // Bytes that left the MCU towards the strip
+  uint32_t wireHash;      // FNV-1a over those bytes
+  uint32_t displayHash;   // FNV-1a over the modelled strip after each frame
+};
+
+// SPI bytes a WS2811 NEO_SPI strip sent since hostResetTrace(), as many as
+// fit; see spiCheck.cpp.
+extern uint8_t  hostSpiFrame[4 * 3 * 1024];
+extern uint16_t hostSpiBytes;
+
+extern HostTrace hostTrace;
+
+void hostResetTrace(void);
+void hostWireWrite(uint8_t b);
+void hostWireLatch(void);
+void hostSpiWrite(uint8_t b);
+const uint8_t *hostDisplayPixels(void);
+void hostHashDisplay(void);
+void hostAdvanceMicros(unsigned long us);
+void hostSetPin(uint8_t pin, uint8_t val);
+
+#endif
+
+// End of file.
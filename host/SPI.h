@@ -0,0 +1,34 @@
+#ifndef __HOST_SPI_H
+#define __HOST_SPI_H
+
+#include <Arduino.h>
+
+#define SPI_CLOCK_DIV4   0x00
+#define SPI_CLOCK_DIV16  0x01
+#define SPI_CLOCK_DIV64  0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2   0x04
+#define SPI_CLOCK_DIV8   0x05
+#define SPI_CLOCK_DIV32  0x06
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+// Captures every transferred byte into hostTrace instead of clocking it out.
+class SPIClass {
+ public:
+  void begin(void) {}
+  void end(void) {}
+  void setBitOrder(uint8_t) {}
+  void setDataMode(uint8_t) {}
+  void setClockDivider(uint8_t) {}
+  uint8_t transfer(uint8_t data) { hostWireWrite(data); return 0; }
+};
+
+extern SPIClass SPI;
+
+#endif
+
+// End of file.
@@ -0,0 +1,155 @@
+// Implementation of the host-side Arduino stand-in declared in Arduino.h.
+#include <stdio.h>
+#include <Arduino.h>
+#include <SPI.h>
+
+volatile uint8_t  TCCR1A, TCCR1B, TIMSK1, TIFR1, UDINT = 1; // USB detached
+volatile uint8_t  TCCR3A, TCCR3B, TIMSK0, OCR0A;
+volatile uint8_t  ADMUX, ADCSRA, ADCSRB, SREG;
+volatile uint16_t OCR1A, OCR1B, TCNT3, ADC;
+volatile uint8_t  hostPort;
+volatile uint8_t  hostRegisters[0x60];
+
+HostTrace  hostTrace;
+SPIClass   SPI;
+HostSerial Serial;
+
+static unsigned long hostMicros;
+static uint8_t       hostPins[32];
+static unsigned long hostRandom = 1;
+
+// Model of the LEDs at the end of the wire: 3 bytes per pixel.
+static uint8_t  hostDisplay[3 * 1024];
+static uint16_t hostDisplayPos;
+
+uint8_t  hostSpiFrame[4 * 3 * 1024];
+uint16_t hostSpiBytes;
+
+unsigned long micros(void) {
+  // Tick on every read so busy-waits on micros() make progress.
+  return hostMicros++;
+}
+
+unsigned long millis(void) {
+  return hostMicros / 1000;
+}
+
+void delay(unsigned long ms) {
+  hostMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostMicros += us;
+}
+
+void hostAdvanceMicros(unsigned long us) {
+  hostMicros += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  // Inputs idle high through their pull-ups, like the buttons on the board.
+  if(mode == INPUT_PULLUP)
+    hostSetPin(pin, HIGH);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  hostSetPin(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < sizeof(hostPins) ? hostPins[pin] : LOW;
+}
+
+void hostSetPin(uint8_t pin, uint8_t val) {
+  if(pin < sizeof(hostPins))
+    hostPins[pin] = val ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  // A healthy 3.9 V pack at 5 mV per count.
+  return 780;
+}
+
+void analogReference(uint8_t mode) {
+}
+
+// Small deterministic LCG so that benchmark runs are repeatable.
+long random(long howbig) {
+  if(howbig == 0)
+    return 0;
+  hostRandom = hostRandom * 1103515245UL + 12345UL;
+  return (long)((hostRandom >> 16) & 0x7fff) % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if(howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if(seed != 0)
+    hostRandom = seed;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+void HostSerial::print(const char *s)     { fputs(s, stdout); }
+void HostSerial::print(char c)            { putchar(c); }
+void HostSerial::print(unsigned long n)   { printf("%lu", n); }
+void HostSerial::println(void)            { putchar('\n'); }
+void HostSerial::println(const char *s)   { puts(s); }
+void HostSerial::println(unsigned long n) { printf("%lu\n", n); }
+
+static uint32_t fnv1a(uint32_t hash, uint8_t b) {
+  return (hash ^ b) * 16777619UL;
+}
+
+void hostResetTrace(void) {
+  memset(&hostTrace, 0, sizeof(hostTrace));
+  hostTrace.wireHash    = 2166136261UL;
+  hostTrace.displayHash = 2166136261UL;
+  hostSpiBytes          = 0;
+}
+
+void hostWireWrite(uint8_t b) {
+  hostTrace.wireBytes++;
+  hostTrace.wireHash = fnv1a(hostTrace.wireHash, b);
+
+#if LED_TYPE == 0
+  // LPD8806: color bytes have the high bit set and are latched by the next
+  // LED down the line that hasn't been written yet; a zero byte restarts
+  // the payload at the first LED.
+  if(!(b & 0x80)) {
+    hostDisplayPos = 0;
+    return;
+  }
+  b &= 0x7f;
+#endif
+
+  if(hostDisplayPos < sizeof(hostDisplay))
+    hostDisplay[hostDisplayPos++] = b;
+}
+
+// WS2811: the pause after a frame makes the next one start at the first LED.
+void hostWireLatch(void) {
+  hostDisplayPos = 0;
+}
+
+void hostSpiWrite(uint8_t b) {
+  if(hostSpiBytes < sizeof(hostSpiFrame))
+    hostSpiFrame[hostSpiBytes++] = b;
+}
+
+const uint8_t *hostDisplayPixels(void) {
+  return hostDisplay;
+}
+
+void hostHashDisplay(void) {
+  for(uint16_t i = 0; i < 3 * PIXEL_COUNT; i++)
+    hostTrace.displayHash = fnv1a(hostTrace.displayHash, hostDisplay[i]);
+}
+
+// End of file.
@@ -0,0 +1,12 @@
+#ifndef __HOST_AVR_INTERRUPT_H
+#define __HOST_AVR_INTERRUPT_H
+
+// There is nothing to mask on the host. ISR bodies compile to plain
+// functions which the host harness may call directly.
+#define cli()
+#define sei()
+#define ISR(vector) extern "C" void vector(void); void vector(void)
+
+#endif
+
+// End of file.
@@ -0,0 +1,21 @@
+#ifndef __HOST_AVR_PGMSPACE_H
+#define __HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Flash and RAM share one address space on the host.
+#define PROGMEM
+#define PSTR(s) (s)
+
+typedef unsigned char prog_uchar;
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+
+#endif
+
+// End of file.
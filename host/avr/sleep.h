@@ -0,0 +1,16 @@
+#ifndef __HOST_AVR_SLEEP_H
+#define __HOST_AVR_SLEEP_H
+
+// Sleeping would only stop virtual time; every sleep returns at once.
+#define SLEEP_MODE_IDLE     0
+#define SLEEP_MODE_PWR_DOWN 2
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()
+#define sleep_mode()
+
+#endif
+
+// End of file.
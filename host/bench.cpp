@@ -0,0 +1,132 @@
+// Render benchmark for the Orion modes on the host.
+//
+// Every mode is driven through updateOrion() exactly as loop() does on the
+// device, with the speed setting at its fastest and virtual time advanced
+// by one animation step between calls, so that each call draws a frame. For each mode this reports the host time per frame together with
+// the driver traffic a frame causes: setPixelColor() and show() calls and
+// the number of bytes clocked out to the strip, and how many show() calls
+// were skipped by the driver because nothing had changed. The last two columns are
+// hashes of the captured byte stream and of what the LEDs would display
+// after each frame; the latter must not change when only the way frames
+// are sent changes.
+#include <stdio.h>
+#include <time.h>
+#include "orion.h"
+
+extern int mode;
+extern int syspeed;
+extern int animationStep;
+extern int frameStep;
+extern int frameDelayTimer;
+
+// Names for the entries of the mode table, by render function.
+static const struct {
+  void (*render)(void);
+  const char *name;
+} modeNames[] = {
+  { rainbow,           "rainbow" },
+  { rainbowBreathing,  "rainbowBreathing" },
+#if ORION_MODE_PLASMA
+  { plasma,            "plasma" },
+#endif
+#if ORION_MODE_SPLIT_COLOR_BUILDER
+  { splitColorBuilder, "splitColorBuilder" },
+#endif
+  { smoothColors,      "smoothColors" },
+  { randomColorChase,  "colorChase" },
+  { randomColorWipe,   "colorWipe" },
+  { randomDither,      "dither" },
+  { randomScanner,     "scanner" },
+  { randomWave,        "wave" },
+  { randomSparkle,     "randomSparkle" },
+  { randomFade,        "fadeIn/fadeOut" },
+#if ORION_MODE_SPARKLER
+  { sparkler,          "sparkler" },
+#endif
+};
+
+static const char *modeName(int m) {
+  ModeDescriptor d;
+  memcpy_P(&d, &modeTable[m], sizeof(d));
+  for(unsigned i = 0; i < sizeof(modeNames) / sizeof(modeNames[0]); i++)
+    if(modeNames[i].render == d.render)
+      return modeNames[i].name;
+  return "?";
+}
+
+#define WARMUP_FRAMES 64
+
+// One animation step of the current mode at the fastest speed setting.
+static void advanceStep(void) {
+  hostAdvanceMicros((unsigned long)frameDelayTimer * ANIMATION_STEP_MICROS / 2);
+}
+
+static uint64_t nanoseconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long frames = argc > 1 ? atol(argv[1]) : 2000;
+  if(frames <= 0)
+    frames = 1;
+
+  setupOrion();
+  enable(true);
+
+  printf("%-7s %6s  %-18s %12s %12s %10s %10s %10s  %-8s  %s\n",
+         "driver", "pixels", "mode", "ns/frame", "setPixel/fr", "show/fr",
+         "skipped/fr", "bytes/fr", "wire", "display");
+
+  for(int m = 0; m < NUMBER_OF_MODES; m++) {
+    setupOrion();
+    mode = m;
+
+    for(int f = 0; f < WARMUP_FRAMES; f++) {
+      updateOrion();
+      advanceStep();
+    }
+
+    hostResetTrace();
+    uint32_t skipped = strip.getSkippedShows();
+    uint64_t start = nanoseconds();
+    for(long f = 0; f < frames; f++) {
+      updateOrion();
+      advanceStep();
+    }
+    uint64_t elapsed = nanoseconds() - start;
+    skipped = strip.getSkippedShows() - skipped;
+    HostTrace timed = hostTrace;
+
+    // Replay the same frames untimed to fingerprint what was displayed.
+    setupOrion();
+    mode = m;
+    for(int f = 0; f < WARMUP_FRAMES; f++) {
+      updateOrion();
+      advanceStep();
+    }
+    hostResetTrace();
+    for(long f = 0; f < frames; f++) {
+      updateOrion();
+      advanceStep();
+      hostHashDisplay();
+    }
+    timed.displayHash = hostTrace.displayHash;
+
+    printf("%-7s %6d  %-18s %12.0f %12.2f %10.2f %10.2f %10.1f  %08lx  %08lx\n",
+           LED_TYPE == 0 ? "LPD8806" : "WS2811", PIXEL_COUNT,
+           modeName(m),
+           (double)elapsed / frames,
+           (double)timed.setPixelCalls / frames,
+           (double)timed.showCalls / frames,
+           (double)skipped / frames,
+           (double)timed.wireBytes / frames,
+           (unsigned long)timed.wireHash,
+           (unsigned long)timed.displayHash);
+  }
+
+  return 0;
+}
+
+// End of file.
@@ -0,0 +1,92 @@
+// Check of the power limiter's running channel sum on the host.
+//
+// The driver keeps the sum of the drive of all pixels up to date as each
+// pixel is written, and show() dims the frame by it. This draws the same
+// frames twice under a power limit: once through setPixelColor() alone, and
+// once with pixelsChanged() before each show(), which counts the sum afresh.
+// The LEDs must end up showing the same. The frames brighten and dim the
+// strip, pixel by pixel and all at once, so the sum has to go both ways.
+#include <stdio.h>
+#include <stdlib.h>
+#include "LPD8806.h"
+#include "WS2811.h"
+#include "strip.h"
+
+#if LED_TYPE == 0
+typedef LPD8806 Driver;
+typedef PixelFormat<7, ORDER_GRB, 0x80> Format;
+#else
+typedef WS2811 Driver;
+typedef PixelFormat<8, ORDER_GRB> Format;
+#endif
+
+static void frame(Driver &strip, boolean recount) {
+  if(recount) strip.pixelsChanged();
+  strip.show();
+  hostHashDisplay();
+  hostAdvanceMicros(100);
+}
+
+// Hash of what the LEDs showed over all the frames.
+static uint32_t run(boolean recount) {
+#if LED_TYPE == 0
+  Driver strip(PIXEL_COUNT);
+#else
+  Driver strip(PIXEL_COUNT, MOSI, NEO_GRB + NEO_KHZ800);
+#endif
+  const uint8_t full = Format::channelMax;
+  const uint32_t white = Format::pack(full, full, full);
+
+  strip.enable(true);
+  // About a third of the strip at full white.
+  strip.setPowerLimit((uint32_t)PIXEL_COUNT * 255);
+  hostResetTrace();
+
+  // All on, then a dark gap chased along it, a pixel at a time.
+  for(uint16_t i = 0; i < PIXEL_COUNT; i++)
+    strip.setPixelColor(i, white);
+  frame(strip, recount);
+  for(uint16_t i = 0; i < PIXEL_COUNT; i++) {
+    strip.setPixelColor(i, Format::pack(0, 0, 0));
+    if(i) strip.setPixelColor(i - 1, white);
+    frame(strip, recount);
+  }
+
+  // The whole strip faded down and up again, one channel ahead.
+  for(int l = full; l >= 0; l -= 9) {
+    for(uint16_t i = 0; i < PIXEL_COUNT; i++)
+      strip.setPixelColor(i, Format::pack(l, l / 2, full - l));
+    frame(strip, recount);
+  }
+  for(int l = 0; l <= full; l += 9) {
+    for(uint16_t i = 0; i < PIXEL_COUNT; i++)
+      strip.setPixelColor(i, Format::pack(l, l / 2, full - l));
+    frame(strip, recount);
+  }
+
+  // Every third pixel dimmed to a half, then off.
+  for(uint8_t d = 1; d <= 2; d++) {
+    for(uint16_t i = 0; i < PIXEL_COUNT; i += 3)
+      strip.setPixelColor(i, d == 1 ? Format::pack(full / 2, full / 2, full / 2)
+                                    : Format::pack(0, 0, 0));
+    frame(strip, recount);
+  }
+  if(!hostTrace.wireBytes) {
+    printf("powerCheck: nothing was sent\n");
+    exit(1);
+  }
+  return hostTrace.displayHash;
+}
+
+int main(void) {
+  uint32_t running = run(false), recounted = run(true);
+  if(running != recounted) {
+    printf("powerCheck: %08lx while drawing, %08lx recounted\n",
+           (unsigned long)running, (unsigned long)recounted);
+    return 1;
+  }
+  printf("powerCheck: ok\n");
+  return 0;
+}
+
+// End of file.
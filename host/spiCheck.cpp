@@ -0,0 +1,106 @@
+// Check of the WS2811 NEO_SPI bitstream on the host.
+//
+// Sends frames of known pixels through a NEO_SPI strip at 800 KHz and
+// reads the SPI bytes back as the line would carry them: every data bit
+// must be one high pulse followed by low, with the high and low times and
+// the bit period inside the WS2812B (V5) datasheet windows, and the bits
+// must give back the bytes the strip was sent. Between SPI bytes MOSI
+// idles low for a moment longer (see WS2811.cpp), which only stretches the
+// low part and cannot be seen here.
+#include <stdio.h>
+#include "WS2811.h"
+
+// One SPI bit at F_CPU/4, in ns.
+#define SPI_BIT_NS (4000000000UL / F_CPU)
+
+// WS2812B (V5) timings, in ns.
+#define T0H_MIN  220
+#define T0H_MAX  380
+#define T0L_MIN  580
+#define T0L_MAX 1000
+#define T1H_MIN  580
+#define T1H_MAX 1000
+#define T1L_MIN  220
+#define T1L_MAX  420
+
+static int failures;
+
+static void fail(const char *what, uint16_t n) {
+  if(failures++ < 10)
+    printf("spiCheck: %s at data byte %u\n", what, n);
+}
+
+static boolean within(unsigned long ns, unsigned long lo, unsigned long hi) {
+  return ns >= lo && ns <= hi;
+}
+
+// Checks the last frame against the 'count' bytes the LEDs were sent.
+static void checkFrame(const uint8_t *sent, uint16_t count) {
+  if(hostSpiBytes != 4 * count) {
+    printf("spiCheck: %u SPI bytes for %u data bytes\n", hostSpiBytes, count);
+    failures++;
+    return;
+  }
+  for(uint16_t n = 0; n < count; n++) {
+    uint8_t data = 0;
+    for(uint8_t i = 0; i < 8; i++) {
+      // Data bit i of this byte is SPI bits 4i to 4i + 3, high bit first.
+      uint8_t nibble = hostSpiFrame[4 * n + i / 2] >> ((i & 1) ? 0 : 4) & 0x0f;
+      uint8_t high = 0, low = 0;
+      while(high < 4 && (nibble & (0x08 >> high))) high++;
+      while(high + low < 4 && !(nibble & (0x08 >> (high + low)))) low++;
+      if(high + low != 4 || !high || !low) {
+        fail("not a single pulse", n);
+        continue;
+      }
+      unsigned long highNs = high * SPI_BIT_NS, lowNs = low * SPI_BIT_NS;
+      boolean one = within(highNs, T1H_MIN, T1H_MAX);
+      if(one ? !within(lowNs, T1L_MIN, T1L_MAX)
+             : !within(highNs, T0H_MIN, T0H_MAX) ||
+               !within(lowNs, T0L_MIN, T0L_MAX))
+        fail("bit out of timing", n);
+      data = (data << 1) | one;
+    }
+    if(data != sent[n]) fail("wrong data", n);
+  }
+}
+
+int main(void) {
+  WS2811 strip(PIXEL_COUNT, MOSI, NEO_GRB + NEO_KHZ800 + NEO_SPI);
+  strip.begin();
+
+  // Every channel value once, then all off and all on, each at a few
+  // brightness settings.
+  static const uint8_t levels[] = { 0, 255, 128, 1 };
+  for(uint8_t l = 0; l < sizeof(levels); l++) {
+    strip.setBrightness(levels[l]);
+    for(uint16_t first = 0; first < 256; first += 3 * PIXEL_COUNT) {
+      for(uint16_t i = 0; i < PIXEL_COUNT; i++) {
+        uint16_t c = first + 3 * i;
+        strip.setPixelColor(i, ((uint32_t)(c & 0xff) << 16) |
+                               (((c + 1) & 0xff) << 8) | ((c + 2) & 0xff));
+      }
+      hostResetTrace();
+      strip.show();
+      checkFrame(hostDisplayPixels(), 3 * PIXEL_COUNT);
+      hostAdvanceMicros(100);
+    }
+    for(uint8_t v = 0; v < 2; v++) {
+      for(uint16_t i = 0; i < PIXEL_COUNT; i++)
+        strip.setPixelColor(i, v ? 0xffffff : 0);
+      hostResetTrace();
+      strip.show();
+      checkFrame(hostDisplayPixels(), 3 * PIXEL_COUNT);
+      hostAdvanceMicros(100);
+    }
+  }
+
+  if(failures) {
+    printf("spiCheck: %d failures\n", failures);
+    return 1;
+  }
+  printf("spiCheck: ok\n");
+  return 0;
+}
+
+// End of file.
@@ -1,52 +1,148 @@
+#include <limits.h>
+#include <avr/sleep.h>
 #include "WS2811.h"
 #include "LPD8806.h"
 #include "orion.h"
-#include "gamma.h"
+#include "sine.h"
+#include "wheel.h"
 #include "pins.h"
+#include "batteryStatus.h"
+#include "buttons.h"
+#include "profiler.h"
 
-byte stripBufferA[PIXEL_COUNT];
-byte stripBufferB[PIXEL_COUNT];
-
-// Semaphores for button interrupts
-boolean brightnessSemaphore = false;
-boolean speedSemaphore = false;
-boolean modeSemaphore = false;
 boolean drawSingleFrame = false;
+boolean modeEntered = true; // The current mode has not drawn a frame yet
+
+// RAM the modes keep from one frame to the next, besides the strip itself.
+// Only one mode runs at a time, so they all share the same memory, which
+// is cleared each time a mode is entered. A mode left out (ORION_MODE_*)
+// takes no part, so its memory does not count against the others.
+#if ORION_MODE_PLASMA
+struct PlasmaScratch {
+  uint8_t fieldA[PIXEL_COUNT]; // Phase of each wave at each pixel
+  uint8_t fieldB[PIXEL_COUNT];
+};
+#endif
+
+#if ORION_MODE_SPLIT_COLOR_BUILDER
+// Each half of the strip, and the middle pixel, shows one frame's color.
+#define SPLIT_COLOR_HISTORY (PIXEL_COUNT / 2 + 1)
+
+struct SplitColorScratch {
+  uint32_t history[SPLIT_COLOR_HISTORY]; // Colors of the previous frames
+  uint16_t newest;                       // Index of the latest in 'history'
+};
+#endif
 
-// Debounce counters (testing showed that calling millis() is unecessary)
-int brightnessCounter = 0;
-int speedCounter = 0;
-int modeCounter = 0;
+#if ORION_MODE_SPARKLER
+struct SparklerScratch {
+  byte current[PIXEL_COUNT + 1]; // One past the end, always 0, for the blur
+  byte next[PIXEL_COUNT];
+};
+#endif
 
-uint32_t pixelBuffer[PIXEL_COUNT];
+static union {
+#if ORION_MODE_PLASMA
+  PlasmaScratch     plasma;
+#endif
+#if ORION_MODE_SPLIT_COLOR_BUILDER
+  SplitColorScratch splitColor;
+#endif
+#if ORION_MODE_SPARKLER
+  SparklerScratch   sparkler;
+#endif
+} scratch;
 
 int animationStep; // Used for incrementing animations (0-WHEEL_RANGE)
 int frameStep;     // Used to increment frame counts.
+int previousFrameStep;    // frameStep when the previous frame was drawn
+boolean animationWrapped; // animationStep came back around to 0 since the previous frame
+boolean frameWrapped;     // frameStep came back around to 0 since the previous frame
 int mode;          // System mode
 int syspeed;         // System animation speed control
 int brightness;    // System brightness control
 
 int frameDelayTimer = 5;
-unsigned long previousMillis = 0;
-unsigned long currentMillis = millis();
-
-#if LED_TYPE == 0
-    LPD8806 strip = LPD8806(PIXEL_COUNT);
+static uint32_t currentColor; // Random color for the modes which cycle through colors.
+unsigned long previousMicros = 0;
+uint32_t stepPhase = 0; // Elapsed part of the next animation step, 8.24 fixed point
+uint32_t stepRate = 0;  // Animation steps per microsecond, 8.24 fixed point
+
+// A StaticStrip has its length built in; a Strip takes it first.
+#if LED_TYPE == 0 && ORION_STATIC_PIXELS
+    OrionStrip strip;
+#elif LED_TYPE == 0
+    OrionStrip strip(PIXEL_COUNT);
 #endif
 #if LED_TYPE == 1
-    WS2811 strip = WS2811(PIXEL_COUNT, MOSI, NEO_GRB + NEO_KHZ800);
+// The channel order comes from OrionFormat, so the driver's per-channel
+// curves always match how the modes pack their colors.
+static const uint8_t neoType =
+  (OrionFormat::order == ORDER_GRB ? NEO_GRB : NEO_RGB) + NEO_KHZ800 +
+  (WS2811_USE_SPI ? NEO_SPI : 0);
+#endif
+#if LED_TYPE == 1 && ORION_STATIC_PIXELS
+    OrionStrip strip(MOSI, neoType);
+#elif LED_TYPE == 1
+    OrionStrip strip(PIXEL_COUNT, MOSI, neoType);
+#endif
+
+#if ORION_STATIC_PIXELS && defined(RAMEND)
+// Of the RAM taken, only the pixel data and the scratch memory of the
+// modes grow with PIXEL_COUNT.
+static_assert(sizeof(strip) + sizeof(scratch) + ORION_RAM_RESERVE_BYTES <= RAMEND + 1 - RAMSTART,
+              "PIXEL_COUNT is too large for the RAM of this MCU");
 #endif
 
+// Start the current mode afresh, from its first step, in cleared scratch
+// memory and with the strip origin back at pixel 0.
+static void startMode(void) {
+  frameStep = 0;
+  animationStep = 0;
+  previousFrameStep = 0;
+  animationWrapped = true;
+  frameWrapped = true;
+  modeEntered = true;
+  memset(&scratch, 0, sizeof(scratch));
+  strip.setOrigin(0);
+} // startMode()
+
+// Button actions, taken by loop() on the queued button events.
 void stepMode(void) {
-  modeSemaphore = true;  
+  mode++;
+
+  if(mode >= NUMBER_OF_MODES)
+    mode = 0;
+
+  // Force redraw of new mode by increasing the speed from paused.
+  if(syspeed == NUMBER_SPEED_SETTINGS)
+    drawSingleFrame = true;
+
+  startMode();
 } // stepMode()
 
 void stepSpeed(void) {
-  speedSemaphore = true;
+  syspeed++;
+
+  if(syspeed > NUMBER_SPEED_SETTINGS)
+    syspeed = 0;
 } // stepSpeed()
 
 void stepBrightness(void) {
-  brightnessSemaphore = true;
+  brightness++;
+
+  if(brightness > NUMBER_BRIGHTNESS_LEVELS-1)
+    brightness = 0;
+
+  if(brightness == 0)
+  {
+    strip.setBrightness(255);
+    if(syspeed == NUMBER_SPEED_SETTINGS)
+      drawSingleFrame = true;
+  } else {
+    strip.setBrightness((255/NUMBER_BRIGHTNESS_LEVELS)*(NUMBER_BRIGHTNESS_LEVELS-brightness));
+  }
+  strip.show();
 } // stepBrightness()
 
 void enable(boolean setBegun) {
@@ -71,15 +167,13 @@ boolean isDisabled(void) {
 
 void setupOrion() {
 
-  for(int u = 0; u<PIXEL_COUNT; u++)
-    pixelBuffer[u] = 0;
-  
   // globalSpeed controls the delays in the animations. Starts low. Range is 1-5. 
   // Each animation is responsible for calibrating its own speed relative to the globalSpeed.
   syspeed = 0;
-  animationStep = 0;
-  frameStep = 0;
+  stepPhase = 0;
+  previousMicros = micros();
   mode = 0;
+  startMode();
 
   // Range is 1 (least bright) to 255 (most bright)
   // Scaled to 0 - NUMBER_BRIGHTNESS_LEVELS
@@ -87,232 +181,291 @@ void setupOrion() {
 } // setupOrion()
 
 
+// Modes drawing with a random color, for the table below.
+void randomColorChase(void) { colorChase(currentColor); }
+void randomColorWipe(void)  { colorWipe(currentColor); }
+void randomDither(void)     { dither(currentColor); }
+void randomScanner(void)    { scanner(currentColor); }
+void randomWave(void)       { wave(currentColor); }
+
+void randomFade(void) {
+  if(animationStep<(WHEEL_RANGE/2))
+    fadeIn(currentColor); 
+  else
+    fadeOut(currentColor);
+}
+
+// The modes, in the order the mode button steps through them. Each entry is
+// compiled in only when its ORION_MODE_* option is set, and nothing else
+// refers to a mode's function, so a mode left out costs neither flash nor RAM.
+// Slow modes require a low frameDelay (1-5). Fast modes require a high frameDelay (5+).
+const ModeDescriptor modeTable[NUMBER_OF_MODES] PROGMEM = {
+#if ORION_MODE_RAINBOW
+  { rainbow,           1,  RESEED_NEVER },        // Smooth rainbow animation.
+#endif
+#if ORION_MODE_RAINBOW_BREATHING
+  { rainbowBreathing,  1,  RESEED_NEVER },
+#endif
+#if ORION_MODE_PLASMA
+  { plasma,            10, RESEED_NEVER },
+#endif
+#if ORION_MODE_SPLIT_COLOR_BUILDER
+  { splitColorBuilder, 5,  RESEED_NEVER },
+#endif
+#if ORION_MODE_SMOOTH_COLORS
+  { smoothColors,      5,  RESEED_NEVER },
+#endif
+#if ORION_MODE_COLOR_CHASE
+  { randomColorChase,  5,  RESEED_FRAME },        // Single pixel random color pixel chase.
+#endif
+#if ORION_MODE_COLOR_WIPE
+  { randomColorWipe,   5,  RESEED_FRAME },        // Random color wipe.
+#endif
+#if ORION_MODE_DITHER
+  { randomDither,      8,  RESEED_FRAME },        // Random color dither. This is a color to color dither (does not clear between colors).
+#endif
+#if ORION_MODE_SCANNER
+  { randomScanner,     5,  RESEED_FRAME },
+#endif
+#if ORION_MODE_WAVE
+  { randomWave,        5,  RESEED_ANIMATION },    // Sin wave effect. New color every cycle.
+#endif
+#if ORION_MODE_RANDOM_SPARKLE
+  { randomSparkle,     3,  RESEED_NEVER },        // Random color noise animation.
+#endif
+#if ORION_MODE_FADE
+  { randomFade,        5,  RESEED_FRAME },        // Color fade-in fade-out effect
+#endif
+#if ORION_MODE_SPARKLER
+  { sparkler,          10, RESEED_NEVER },
+#endif
+};
+
+static_assert(sizeof(modeTable) == NUMBER_OF_MODES * sizeof(ModeDescriptor),
+              "Mode table does not match the ORION_MODE_* options");
+
+// Keep the strip within the current budget for the present battery voltage
+// (see CURRENT_BUDGET_MA). Only does any work when the voltage has changed.
+static void updatePowerLimit(void) {
+  static uint16_t lastMillivolts = 0xFFFF;
+  uint16_t millivolts = batteryMillivolts();
+  uint32_t budget; // mA
+
+  if(millivolts == lastMillivolts)
+    return;
+  lastMillivolts = millivolts;
+
+  if(millivolts == 0 || millivolts >= BATTERY_FULL_MILLIVOLTS)
+    budget = CURRENT_BUDGET_MA; // Also before the first battery reading
+  else if(millivolts <= BATTERY_LOW_MILLIVOLTS)
+    budget = CURRENT_BUDGET_LOW_MA;
+  else
+    budget = CURRENT_BUDGET_LOW_MA +
+             (uint32_t)(CURRENT_BUDGET_MA - CURRENT_BUDGET_LOW_MA) *
+             (millivolts - BATTERY_LOW_MILLIVOLTS) /
+             (BATTERY_FULL_MILLIVOLTS - BATTERY_LOW_MILLIVOLTS);
+
+  // Budget as the sum of the channel drives (values after the output
+  // curves) the strip may show at once.
+  strip.setPowerLimit(budget * 1000 * OrionStrip::channelMax / CHANNEL_FULL_MICROAMPS);
+} // updatePowerLimit()
+
+
 // All animations are controlled by a unified timing method.
 // All animations must be totally non-blocking. That is, draw only one frame at a time.
 void updateOrion() {
-    
-  if(brightnessSemaphore)
-  {  
-    if(digitalRead(PIN_BUTTON_LEVEL)==HIGH)
-    {
-      brightnessCounter++; 
-    } else {
-       brightnessSemaphore = false; // Disarm the semaphore (button press time < minimum) 
-    }
-    
-    if(brightnessCounter>10)
-      {
-      brightnessSemaphore = false; 
-      brightnessCounter = 0; 
-      
-      brightness++;
-      
-     if(brightness > NUMBER_BRIGHTNESS_LEVELS-1)
-      brightness = 0;
-
-      if(brightness == 0)
-      {
-        strip.setBrightness(255);    
-        if(syspeed == NUMBER_SPEED_SETTINGS)
-          drawSingleFrame = true;
-      } else {
-        strip.setBrightness((255/NUMBER_BRIGHTNESS_LEVELS)*(NUMBER_BRIGHTNESS_LEVELS-brightness));    
-      }
-      strip.show();
-      }
-  }
-
-  if(speedSemaphore)
-  {  
-    if(digitalRead(PIN_BUTTON_SPEED)==HIGH)
-    {
-      speedCounter++; 
-    } else {
-      speedSemaphore = false; // Disarm the semaphore (button press time < minimum) 
-    }
-    
-    if(speedCounter>10)
-      {
-      syspeed++;
-      
-       if(syspeed > NUMBER_SPEED_SETTINGS)
-         syspeed = 0;
-         
-       speedSemaphore = false;
-       speedCounter = 0;
-      }
-  }
-  
-  if(modeSemaphore)
-  { 
-    if(digitalRead(PIN_BUTTON_MODE)==HIGH)
-    {
-      modeCounter++; 
-    } else {
-      modeSemaphore = false; // Disarm the semaphore (button press time < minimum) 
-    }
-    
-    if(modeCounter>10)
-      {
-      mode++;
-       
-      if(mode > NUMBER_OF_MODES)
-        mode = 0;
-        
-      // Force redraw of new mode by increasing the speed from paused.
-      if(syspeed == NUMBER_SPEED_SETTINGS)
-         drawSingleFrame = true;
-         
-      frameStep = 0;
-      animationStep = 0;
-      modeSemaphore = false;
-      modeCounter = 0;
-      }
-  }  
-  
-  // Used to store a current color for modes which cycle through colors.
-  static uint32_t currentColor;
+  ModeDescriptor currentMode;
+  memcpy_P(&currentMode, &modeTable[mode], sizeof(currentMode));
+  frameDelayTimer = currentMode.frameDelay;
 
+  // Animations are driven by elapsed time, not by the number of frames drawn.
   // This is used to calibrate the speed range for different modes
   // Slow modes require a low frameDelayTimer (1-5). Fast modes require a high frameDelayTimer (5+).
-  // millis() rolls over after 49 days of operation. 
-  currentMillis = millis();
+  // One step lasts frameDelayTimer*syspeed ms; speed 0 is twice as fast as speed 1.
+  // micros() rolls over after 70 minutes, which the unsigned subtraction absorbs.
+  unsigned long currentMicros = micros();
+  unsigned long elapsed = currentMicros - previousMicros;
+  previousMicros = currentMicros;
 
-  // If insufficient time has elapsed since the last call just return and do nothing.
-  // Each animation needs to be calibrated using frameDelayTimer to get a good range of speeds.
-  if(currentMillis - previousMillis < frameDelayTimer*syspeed)    
-    return;
-    
   //Pause animations if speed is set to highest (slowest) setting.
   if(syspeed == NUMBER_SPEED_SETTINGS && !drawSingleFrame)
     return;
-    
+
+  // Don't try to catch up on a long stall (or the pause above) all at once.
+  if(elapsed > MAX_STEP_ELAPSED_MICROS)
+    elapsed = MAX_STEP_ELAPSED_MICROS;
+
+  // Steps per microsecond in 8.24 fixed point, rounded up so that a call
+  // made exactly one step period later always yields a step.
+  uint32_t stepMicros = (uint32_t)frameDelayTimer *
+                        (syspeed ? syspeed * ANIMATION_STEP_MICROS : ANIMATION_STEP_MICROS / 2);
+  stepRate = ((1UL << 24) + stepMicros - 1) / stepMicros;
+  stepPhase += elapsed * stepRate;
+  uint16_t steps = stepPhase >> 24;
+  stepPhase &= 0xFFFFFFUL;
+
+  // If not a whole step has elapsed since the last frame just return and do nothing.
+  // A mode that takes longer than a step to draw simply skips the steps it missed.
+  if(steps == 0) {
+    if(!drawSingleFrame)
+      return;
+    steps = 1;
+  }
+
   if(drawSingleFrame)
     drawSingleFrame = false;
-    
-  previousMillis = currentMillis;
-
-  switch(mode) {
-    case 0:
-      rainbow(); // Smooth rainbow animation.
-      frameDelayTimer = 1;
-      break;
-    case 1:
-      rainbowBreathing();
-      frameDelayTimer = 1;
-      break;
-    case 2:
-      plasma();
-      frameDelayTimer = 10;    
-      break;
-    case 3:
-      splitColorBuilder();
-      frameDelayTimer = 5;
-      break;
-    case 4:
-      smoothColors();
-      frameDelayTimer = 5;
-      break;
-    case 5:
-      // Single pixel random color pixel chase.
-      if(frameStep == 0)
-        currentColor = Wheel(random(0, WHEEL_RANGE));
-      colorChase(currentColor);
-      frameDelayTimer = 5;    
-      break;
-    case 6:
-      // Random color wipe.
-      if(frameStep == 0)
-        currentColor = Wheel(random(0, WHEEL_RANGE));
-      colorWipe(currentColor);
-      frameDelayTimer = 5;    
-      break;
-    case 7:
-      // Random color dither. This is a color to color dither (does not clear between colors).
-      if(frameStep == 0)
-        currentColor = Wheel(random(0, WHEEL_RANGE));
-      dither(currentColor);
-      frameDelayTimer = 8;    
-      break;
-    case 8:
-      if(frameStep == 0)
-        currentColor = Wheel(random(0, WHEEL_RANGE));
-      scanner(currentColor);  
-      frameDelayTimer = 5;    
-      break;
-    case 9:
-      // Sin wave effect. New color every cycle.
-      if(animationStep == 0)
-        currentColor = Wheel(random(0, WHEEL_RANGE));
-      wave(currentColor);  
-      frameDelayTimer = 5;    
-      break;
-    case 10:
-      // Random color noise animation.
-      randomSparkle();
-      frameDelayTimer = 3;    
-      break;
-    case 11:
-      // Color fade-in fade-out effect
-      if(frameStep==0)
-        currentColor =Wheel(random(0, WHEEL_RANGE));
-      
-      if(animationStep<(WHEEL_RANGE/2))
-        fadeIn(currentColor); 
-      else
-        fadeOut(currentColor);
-    
-      frameDelayTimer = 5;
-      break;
-    case 12:
-      sparkler();
-      frameDelayTimer = 10;
-      break;
-    default:
-      ; // This should never happen. 
-  } // switch()
+
+  updatePowerLimit();
+
+  uint16_t profileStart = profileBegin(PROFILE_RENDER);
+
+  // New random color for the modes that use one, at the start of each cycle.
+  if((currentMode.reseed == RESEED_FRAME     && frameWrapped) ||
+     (currentMode.reseed == RESEED_ANIMATION && animationWrapped))
+    currentColor = Wheel(random(0, WHEEL_RANGE));
+
+  currentMode.render();
+  modeEntered = false;
+
+  profileEnd(PROFILE_RENDER, profileStart);
   
+  // Advance by every step that elapsed, noting when a counter wraps so that
+  // modes reseed on the wrap rather than waiting for a step they may skip.
+  previousFrameStep = frameStep;
+
   // Global animation frame limit of WHEEL_RANGE (for full color wheel range).
   // Large animationSteps slow down the driver.
-  animationStep++;
-    
-  if(animationStep>WHEEL_RANGE)
-    animationStep = 0;
+  animationStep += steps;
+  animationWrapped = animationStep > WHEEL_RANGE;
+  if(animationWrapped)
+    animationStep %= WHEEL_RANGE + 1;
   
   // Ensure that only as many pixels are drawn as there are in the strip.
-  frameStep++;
-  if(frameStep > PIXEL_COUNT)
-    frameStep = 0;
+  frameStep += steps;
+  frameWrapped = frameStep > PIXEL_COUNT;
+  if(frameWrapped)
+    frameStep %= PIXEL_COUNT + 1;
 } // updateOrion()
 
 
+// Microseconds until updateOrion() next has something to do: 0 while a
+// button event is waiting or a frame is due, ULONG_MAX while the animation
+// is paused (only a button press can change anything then).
+unsigned long microsToNextFrame(void) {
+  if(buttonEventPending() || drawSingleFrame)
+    return 0;
+
+  if(syspeed == NUMBER_SPEED_SETTINGS)
+    return ULONG_MAX;
+
+  if(stepRate == 0) // No frame drawn yet
+    return 0;
+
+  // Time left in the current step, less what passed since it was last counted.
+  unsigned long remaining = ((1UL << 24) - stepPhase) / stepRate;
+  unsigned long elapsed   = micros() - previousMicros;
+  return remaining > elapsed ? remaining - elapsed : 0;
+} // microsToNextFrame()
+
+
+// Idle the CPU until the next interrupt when the next frame is further off
+// than IDLE_MIN_MICROS. Timer0 (millis and the button sampling) still ticks
+// every 1024 us, and the battery and USB interrupts still wake it, so the
+// caller simply goes around loop() again and checks whether there is work.
+void idleUntilNextFrame(void) {
+  if(microsToNextFrame() < IDLE_MIN_MICROS)
+    return;
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+
+  // A button event raised between the check and the sleep would go
+  // unnoticed until the next wake-up, so the check is made with interrupts
+  // off. The instruction after sei() always runs before any interrupt, so
+  // nothing can slip in before sleep_cpu() either.
+  cli();
+  if(!buttonEventPending()) {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+} // idleUntilNextFrame()
+
+
 void solidColor()
 {
-    for (int i=0; i < strip.numPixels(); i++) {
-     strip.setPixelColor(i, strip.Color(127, 127, 127));
-    }
+    strip.fill(0, strip.numPixels(), strip.Color(127, 127, 127));
     strip.show();
 
 }
 
+#if ORION_MODE_PLASMA
+// Integer square root (floor) by binary digit extraction.
+static uint16_t isqrt(uint32_t x) {
+  uint32_t root = 0;
+  uint32_t bit  = 1UL << 30;
+
+  while(bit > x)
+    bit >>= 2;
+
+  while(bit) {
+    if(x >= root + bit) {
+      x   -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+} // isqrt()
+
+
+// Distance of pixel y from (cx, cy), with the pixel at x = 0, as a sin8()
+// angle. One radian per 4 pixels of distance is 256/(2*PI)/4 = 10.19 angle
+// steps per pixel, so the squared distance is scaled by 10.19^2 ~= 104.
+static uint8_t plasmaPhase(int y, int cx, int cy) {
+  int32_t dx = cx;
+  int32_t dy = y - cy;
+  return isqrt((uint32_t)(dx*dx + dy*dy) * 104);
+} // plasmaPhase()
+
+
+// Sum of two sine waves rippling out from points off the side of the strip.
+// The distances never change, so they are worked out once per pixel, when
+// the mode is entered; each frame only slides the phase of each wave and costs two sin8() lookups
+// and an add per pixel.
 void plasma() {
-  
-    double time = animationStep;
-            
-    for(int y = 0; y < PIXEL_COUNT; y++)
-    {
-        double value = sin(dist(frameStep + time, y, 64.0, 64.0) / 4.0)
-                   + sin(dist(frameStep, y, 32.0, 32.0) / 4.0);
-                   + sin(dist(frameStep, y + time / 7, 95.0, 32) / 3.5);
-                   + sin(dist(frameStep, y, 95.0, 50.0) / 4.0);
-  
-      int color = int((4 + value)*WHEEL_RANGE)%WHEEL_RANGE;
-      strip.setPixelColor(y, Wheel(color)); 
-    }    
+  uint8_t *plasmaFieldA = scratch.plasma.fieldA;
+  uint8_t *plasmaFieldB = scratch.plasma.fieldB;
+
+  if(modeEntered) {
+    for(int y = 0; y < PIXEL_COUNT; y++) {
+      plasmaFieldA[y] = plasmaPhase(y, 64, 64);
+      plasmaFieldB[y] = plasmaPhase(y, 32, 32);
+    }
+  }
+
+  uint8_t phaseA = animationStep * 8;
+  uint8_t phaseB = frameStep * 8;
+
+  for(int y = 0; y < PIXEL_COUNT; y++)
+  {
+    int16_t value = sin8(plasmaFieldA[y] - phaseA)
+                  + sin8(plasmaFieldB[y] + phaseB); // -254..254
+
+    // One full turn of the color wheel per unit of value (127).
+    strip.setPixelColor(y, Wheel8(value * 2)); 
+  }    
   strip.show();
 }
+#endif // ORION_MODE_PLASMA
 
+#if ORION_MODE_SPARKLER
 void sparkler() {
+  byte *stripBufferA = scratch.sparkler.current;
+  byte *stripBufferB = scratch.sparkler.next;
   
   stripBufferA[random(0,PIXEL_COUNT)] = random(0, WHEEL_RANGE);
 
@@ -332,6 +485,7 @@ void sparkler() {
       stripBufferA[x] = stripBufferB[x];
   
 }
+#endif // ORION_MODE_SPARKLER
 
 
 void rainbowBreathing()
@@ -350,7 +504,7 @@ void rainbowBreathing()
     int fadeAnimation = map(animationStep, 0, WHEEL_RANGE/2, 0, ceiling);
     
     for (i=0; i < pixelCount; i++) 
-      strip.setPixelColor(i, Wheel(((i * (WHEEL_RANGE / pixelCount))) % WHEEL_RANGE)); 
+      strip.setPixelColor(i, Wheel(i * (WHEEL_RANGE / pixelCount))); 
       
     strip.setBrightness(fadeAnimation);
 
@@ -363,7 +517,7 @@ void rainbowBreathing()
     int fadeAnimation = ceiling-scaleAS;
           
     for (i=0; i < pixelCount; i++) 
-      strip.setPixelColor(i, Wheel(((i * (WHEEL_RANGE / pixelCount))) % WHEEL_RANGE)); 
+      strip.setPixelColor(i, Wheel(i * (WHEEL_RANGE / pixelCount))); 
       
     strip.setBrightness(fadeAnimation);
 
@@ -372,288 +526,134 @@ void rainbowBreathing()
 } 
   
   
+// The whole color wheel is drawn around the strip once, when the mode is
+// entered, and from then on turned by moving the origin of the strip, so
+// a frame costs the same whatever the length. It turns a whole pixel at a
+// time, one for every WHEEL_RANGE/pixelCount animation steps.
 void rainbow() {
-  uint16_t i, j;
+  uint16_t i;
   int pixelCount = strip.numPixels();
-  for (i=0; i < strip.numPixels(); i++) 
-    strip.setPixelColor(i, Wheel(((i * WHEEL_RANGE / pixelCount) + animationStep) % WHEEL_RANGE)); 
+
+  if(modeEntered) {
+    // Walk i*WHEEL_RANGE/pixelCount with a running quotient and remainder
+    // instead of a multiply, divide and modulo per pixel.
+    uint16_t hue     = 0;
+    uint16_t hueStep = WHEEL_RANGE / pixelCount;
+    uint16_t hueRem  = WHEEL_RANGE % pixelCount;
+    uint16_t rem     = 0;
+
+    for (i=0; i < pixelCount; i++) 
+    {
+      strip.setPixelColor(i, Wheel(hue)); 
+      hue += hueStep;
+      rem += hueRem;
+      if(rem >= pixelCount) {
+        rem -= pixelCount;
+        hue++;
+      }
+    }
+  }
+
+  strip.setOrigin(((uint32_t)animationStep * pixelCount + WHEEL_RANGE/2) / WHEEL_RANGE);
   strip.show();   // write all the pixels out
 }
 
 
+#if ORION_MODE_SPLIT_COLOR_BUILDER
+// The history holds the colors of the previous frames, newest first from
+// 'newest' and wrapping around, so that a frame only adds one to it. The
+// halves of the strip scroll in opposite directions, away from the
+// middle, which a single origin cannot do, so every pixel is still set.
 void splitColorBuilder() {
+  uint32_t *pixelBuffer = scratch.splitColor.history;
+  uint16_t &newest      = scratch.splitColor.newest;
   uint16_t i, j;
   int pixelCount = strip.numPixels();  
   uint32_t c = Wheel(animationStep);
-  float y = (sin(PI * 1 * (float)(animationStep) / (float)strip.numPixels()/4))+1;
+  // 1 + sin(PI*animationStep/(4*pixelCount)), as 0..2 in 1.15 fixed point.
+  uint16_t y = 32768 + sin16(((uint32_t)animationStep << 13) / pixelCount);
+  const byte top = OrionStrip::channelMax;
   byte  r, g, b, r2, g2, b2;
 
   // Need to decompose color into its r, g, b elements
-  g = (c >> 16) & 0x7f;
-  r = (c >>  8) & 0x7f;
-  b =  c        & 0x7f; 
+  r = strip.red(c);
+  g = strip.green(c);
+  b = strip.blue(c);
   
-  r2 = 127 - (byte)((float)(127 - r) * y);
-  g2 = 127 - (byte)((float)(127 - g) * y);
-  b2 = 127 - (byte)((float)(127 - b) * y);
+  r2 = top - (byte)(((uint32_t)(top - r) * y) >> 15);
+  g2 = top - (byte)(((uint32_t)(top - g) * y) >> 15);
+  b2 = top - (byte)(((uint32_t)(top - b) * y) >> 15);
   
-  pixelBuffer[0] = strip.Color(r2, g2, b2);
+  if(newest == 0)
+    newest = SPLIT_COLOR_HISTORY;
+  newest--;
+  pixelBuffer[newest] = strip.Color(r2, g2, b2);
 
-  for (i=0; i < (strip.numPixels()/2)+1; i++) 
+  for (i=0, j=newest; i < (strip.numPixels()/2)+1; i++) 
   {
-    strip.setPixelColor(PIXEL_COUNT/2-i, pixelBuffer[i]); 
-    strip.setPixelColor(PIXEL_COUNT/2+i, pixelBuffer[i]); 
+    strip.setPixelColor(PIXEL_COUNT/2-i, pixelBuffer[j]); 
+    strip.setPixelColor(PIXEL_COUNT/2+i, pixelBuffer[j]); 
+    if(++j == SPLIT_COLOR_HISTORY)
+      j = 0;
   }
   
   strip.show();   // write all the pixels out
+}
+#endif // ORION_MODE_SPLIT_COLOR_BUILDER
+
+
+void smoothColors() {
+  // One color for the whole strip, moving round the wheel.
+  uint32_t c = Wheel(animationStep % WHEEL_RANGE);
   
-  for(int k = PIXEL_COUNT-1; k>0; k--)
-  {
-   pixelBuffer[k] = pixelBuffer[k-1]; 
-  }
+  strip.fill(0, strip.numPixels(), c);
+  strip.show();   // write all the pixels out
+}
 
 
+// Fills the strip with 'c', 'y' taken off each channel (down to 0).
+static void fadeFill(uint32_t c, int y)
+{
+  byte  r = strip.red(c), g = strip.green(c), b = strip.blue(c), r2, g2, b2;
+
+  r2 = r > y ? r - y : 0;
+  g2 = g > y ? g - y : 0;
+  b2 = b > y ? b - y : 0;
+
+  strip.fill(0, strip.numPixels(), strip.Color(r2, g2, b2));
+  strip.show();   // write all the pixels out
 }
 
 
-void smoothColors() {
-  uint16_t i, j;
-  int pixelCount = strip.numPixels();
-  uint32_t c = Wheel(((i * WHEEL_RANGE / pixelCount) + animationStep) % WHEEL_RANGE);
-  pixelBuffer[0] = c;
-  
-      for (i=0; i < strip.numPixels(); i++) 
-      {
-        strip.setPixelColor(i, c);
-      }
-      strip.show();   // write all the pixels out
+// The largest of the channels of 'c'.
+static byte highestChannel(uint32_t c)
+{
+  byte highColorByte = strip.red(c);
+  if(strip.green(c) > highColorByte)
+    highColorByte = strip.green(c);
+  if(strip.blue(c) > highColorByte)
+    highColorByte = strip.blue(c);
+  return highColorByte;
 }
 
 
+// Fades out over the second half of the animation steps.
 void fadeOut(uint32_t c)
 {  
+  byte highColorByte = highestChannel(c);
+  int y = (float)highColorByte*((float)animationStep/(WHEEL_RANGE/2) - 1);
 
-  byte  r, g, b, r2, g2, b2, r8, g8,b8;
-  
-  
-  // Need to decompose color into its r, g, b elements
-  if(LED_TYPE == 0)
-  {
-  g = (c >> 16) & 0x7f;
-  r = (c >>  8) & 0x7f;
-  b =  c        & 0x7f; 
- 
-  r8 = r;
-  g8 = g;
-  b8 = b;
-
-  byte highColorByte = 0;
-  if(g8>highColorByte)
-  {highColorByte= g8; }  
-  if(r8>highColorByte)
-  {highColorByte= r8; }
-  if(b8>highColorByte)
-  {highColorByte= b8; }  
-
-  byte lowColorByte = WHEEL_RANGE;
-  if(g8 < lowColorByte)
-  {lowColorByte= g8; }  
-  if(r8 < lowColorByte)
-  {lowColorByte= r8; }
-  if(b8 < lowColorByte)
-  {lowColorByte= b8; }   
-  
-  int y = (float)highColorByte-(float)highColorByte*(float)(2-0.005*animationStep);
-
-      if(g8>y)
-      {
-        g2 =  gamma(g8-y);
-      } else {
-        g2 = gamma(0); 
-      }
-      if(r8>y)
-      {
-        r2 =  gamma(r8-y);
-      } else {
-        r2 = gamma(0); 
-      }
-      if(b8>y)
-      {
-        b2 =  gamma(b8-y);
-      } else {
-        b2 = gamma(0); 
-      }
-      
-    for (int i=0; i < strip.numPixels(); i++) 
-      strip.setPixelColor(i, r2, g2, b2);
-    
-    strip.show();   // write all the pixels out
-  }
-  
-  if(LED_TYPE == 1)
-  {
-    r = (uint8_t)(c >> 16),
-    g = (uint8_t)(c >>  8),
-    b = (uint8_t)c;
- 
-  r8 = r;
-  g8 = g;
-  b8 = b;
-
-  byte highColorByte = 0;
-  if(g8>highColorByte)
-  {highColorByte= g8; }  
-  if(r8>highColorByte)
-  {highColorByte= r8; }
-  if(b8>highColorByte)
-  {highColorByte= b8; }  
-
-  byte lowColorByte = WHEEL_RANGE;
-  if(g8 < lowColorByte)
-  {lowColorByte= g8; }  
-  if(r8 < lowColorByte)
-  {lowColorByte= r8; }
-  if(b8 < lowColorByte)
-  {lowColorByte= b8; }   
-  
-  int y = 0 + (float)lowColorByte*((float)animationStep/(WHEEL_RANGE/2));
-
-      if(g8>y)
-      {
-        g2 =  gamma(g8-y);
-      } else {
-        g2 = gamma(0); 
-      }
-      if(r8>y)
-      {
-        r2 =  gamma(r8-y);
-      } else {
-        r2 = gamma(0); 
-      }
-      if(b8>y)
-      {
-        b2 =  gamma(b8-y);
-      } else {
-        b2 = gamma(0); 
-      }
-      
-    for (int i=0; i < strip.numPixels(); i++) 
-      strip.setPixelColor(i, r2, g2, b2);
-    
-    strip.show();   // write all the pixels out
-  }
+  fadeFill(c, y);
 }
 
 
+// Fades in over the first half of the animation steps.
 void fadeIn(uint32_t c)
 {
-    byte  r, g, b, r2, g2, b2, r8, g8,b8;
+  byte highColorByte = highestChannel(c);
+  int y = (float)highColorByte - (float)highColorByte*((float)animationStep/(WHEEL_RANGE/2));
 
-  // Need to decompose color into its r, g, b elements
-  if(LED_TYPE == 0)
-  {
-  
-  g = (c >> 16) & 0x7f;
-  r = (c >>  8) & 0x7f;
-  b =  c        & 0x7f; 
- 
-  r8 = r;
-  g8 = g;
-  b8 = b;
-
-  byte highColorByte = 0;
-  if(g8>highColorByte)
-  {highColorByte= g8; }  
-  if(r8>highColorByte)
-  {highColorByte= r8; }
-  if(b8>highColorByte)
-  {highColorByte= b8; }  
-
-  byte lowColorByte = WHEEL_RANGE;
-  if(g8 < lowColorByte)
-  {lowColorByte= g8; }  
-  if(r8 < lowColorByte)
-  {lowColorByte= r8; }
-  if(b8 < lowColorByte)
-  {lowColorByte= b8; }   
-
-  int y = (float)highColorByte - (float)highColorByte*((float)animationStep/192);
-
-      if(g8>y)
-      {
-        g2 =  gamma(g8-y);
-      } else {
-        g2 = gamma(0); 
-      }
-      if(r8>y)
-      {
-        r2 =  gamma(r8-y);
-      } else {
-        r2 = gamma(0); 
-      }
-      if(b8>y)
-      {
-        b2 =  gamma(b8-y);
-      } else {
-        b2 = gamma(0); 
-      }
-    for (int i=0; i < strip.numPixels(); i++) 
-      strip.setPixelColor(i, r2, g2, b2);
-    
-    strip.show();   // write all the pixels out
-  }
-  
-  if(LED_TYPE == 1)
-  {
-    r = (uint8_t)(c >> 16),
-    g = (uint8_t)(c >>  8),
-    b = (uint8_t)c;
-
-  r8 = r;
-  g8 = g;
-  b8 = b;
-
-  byte highColorByte = 0;
-  if(g8>highColorByte)
-  {highColorByte= g8; }  
-  if(r8>highColorByte)
-  {highColorByte= r8; }
-  if(b8>highColorByte)
-  {highColorByte= b8; }  
-
-  byte lowColorByte = 255;
-  if(g8 < lowColorByte)
-  {lowColorByte= g8; }  
-  if(r8 < lowColorByte)
-  {lowColorByte= r8; }
-  if(b8 < lowColorByte)
-  {lowColorByte= b8; }   
-
-  int y = (float)lowColorByte - (float)lowColorByte*((float)animationStep/(WHEEL_RANGE/2));
-
-      if(g8>y)
-      {
-        g2 =  gamma(g8-y);
-      } else {
-        g2 = gamma(0); 
-      }
-      if(r8>y)
-      {
-        r2 =  gamma(r8-y);
-      } else {
-        r2 = gamma(0); 
-      }
-      if(b8>y)
-      {
-        b2 =  gamma(b8-y);
-      } else {
-        b2 = gamma(0); 
-      }
-    for (int i=0; i < strip.numPixels(); i++) 
-      strip.setPixelColor(i, r2, g2, b2);
-    
-    strip.show();   // write all the pixels out
-  }
+  fadeFill(c, y);
 }
 
 
@@ -698,10 +698,11 @@ void colorWipe(uint32_t c)
 
 // Chase a dot down the strip
 // Random color for each chase
+// The dot may move more than one pixel per frame, so the one to clear is
+// wherever it was drawn last.
 void colorChase(uint32_t c) 
 {
-  int i;
-  strip.setPixelColor(frameStep-1, 0); 
+  strip.setPixelColor(previousFrameStep, 0); 
   strip.setPixelColor(frameStep, c); 
   strip.show(); // Refresh LED states
 }
@@ -709,9 +710,12 @@ void colorChase(uint32_t c)
 
 // An "ordered dither" fills every pixel in a sequence that looks
 // sparkly and almost random, but actually follows a specific order.
-void dither(uint32_t c) 
+// Fills in every step since the previous frame, so none are left out
+// when frames are dropped. When frameStep has come back around, that is
+// the rest of the previous cycle, in the color it was drawn with (the new
+// one has already been picked), and then the start of the new one.
+static void ditherSteps(int first, int last, uint32_t c)
 {
- 
   // Determine highest bit needed to represent pixel index
   int hiBit = 0;
   int n = strip.numPixels() - 1;
@@ -720,7 +724,7 @@ void dither(uint32_t c)
   }
 
   int bit, reverse;
-  for(int i=frameStep; i<frameStep+1; i++) 
+  for(int i=first; i<=last; i++) 
   {
     // Reverse the bits in i to create ordered dither:
     reverse = 0;
@@ -729,10 +733,24 @@ void dither(uint32_t c)
       if(i & bit) reverse |= 1;
     }
     strip.setPixelColor(reverse, c);
-    strip.show();
   }
 }
 
+void dither(uint32_t c) 
+{
+  static uint32_t previousColor; // Color of the cycle drawn so far
+
+  if(frameWrapped) {
+    if(!modeEntered)
+      ditherSteps(previousFrameStep+1, PIXEL_COUNT, previousColor);
+    ditherSteps(0, frameStep, c);
+  } else {
+    ditherSteps(previousFrameStep+1, frameStep, c);
+  }
+  previousColor = c;
+  strip.show();
+}
+
 
 void randomSparkle() 
 {
@@ -756,9 +774,9 @@ void scanner(uint32_t c) {
   byte  r, g, b;
   
   // Decompose color into its r, g, b elements
-  g = (c >> 16) & 0x7f;
-  r = (c >>  8) & 0x7f;
-  b =  c        & 0x7f; 
+  r = strip.red(c);
+  g = strip.green(c);
+  b = strip.blue(c);
   
   int i, j, pos, dir;
 
@@ -807,29 +825,35 @@ void scanner(uint32_t c) {
 // Sine wave effect.
 // Self calibrating for pixel run length.
 void wave(uint32_t c) {
-  float y;
+  const byte top = OrionStrip::channelMax;
+  int8_t y;
   byte  r, g, b, r2, g2, b2;
 
   // Need to decompose color into its r, g, b elements
-  g = (c >> 16) & 0x7f;
-  r = (c >>  8) & 0x7f;
-  b =  c        & 0x7f; 
+  r = strip.red(c);
+  g = strip.green(c);
+  b = strip.blue(c);
+
+  // The wave spans half a turn across the strip. Angles are kept with 8
+  // extra fraction bits so that odd strip lengths do not drift.
+  uint16_t pixelCount = strip.numPixels();
+  uint32_t theta      = ((uint32_t)animationStep << 23) / pixelCount;
+  uint32_t thetaStep  = (1UL << 23) / pixelCount;
 
-    for(int i=0; i<strip.numPixels(); i++) 
+    for(int i=0; i<pixelCount; i++) 
     {
-      y = sin(PI * 1 * (float)(animationStep + i) / (float)strip.numPixels());
-      if(y >= 0.0) {
+      y = sin16(theta >> 8) >> 8; // -127..127
+      theta += thetaStep;
+      if(y >= 0) {
         // Peaks of sine wave are white
-        y  = 1.0 - y; // Translate Y to 0.0 (top) to 1.0 (center)
-        r2 = 127 - (byte)((float)(127 - r) * y);
-        g2 = 127 - (byte)((float)(127 - g) * y);
-        b2 = 127 - (byte)((float)(127 - b) * y);
+        r2 = r + (((top - r) * y) >> 7);
+        g2 = g + (((top - g) * y) >> 7);
+        b2 = b + (((top - b) * y) >> 7);
       } else {
         // Troughs of sine wave are black
-        y += 1.0; // Translate Y to 0.0 (bottom) to 1.0 (center)
-        r2 = (byte)((float)r * y);
-        g2 = (byte)((float)g * y);
-        b2 = (byte)((float)b * y);
+        r2 = r + ((r * y) >> 7);
+        g2 = g + ((g * y) >> 7);
+        b2 = b + ((b * y) >> 7);
       }
       strip.setPixelColor(i, r2, g2, b2);
     }
@@ -837,60 +861,9 @@ void wave(uint32_t c) {
 }
 
 
-//Input a value 0 to WHEEL_RANGE to get a color value.
-//The colours are a transition r - g - b - back to r
-
-uint32_t Wheel(uint16_t WheelPos)
-{
-  
-  // LPD8806
-  if(LED_TYPE == 0)
-  {
-    byte r, g, b;
-    switch(WheelPos / 128)
-    {
-      case 0:
-        r = 127 - WheelPos % 128; // red down
-        g = WheelPos % 128;       // green up
-        b = 0;                    // blue off
-        break;
-      case 1:
-        g = 127 - WheelPos % 128; // green down
-        b = WheelPos % 128;       // blue up
-        r = 0;                    // red off
-        break;
-      case 2:
-        b = 127 - WheelPos % 128; // blue down
-        r = WheelPos % 128;       // red up
-        g = 0;                    // green off
-        break;
-    }
-    return(strip.Color(r,g,b));
-  }
-  
-  // WS2811
-  if(LED_TYPE == 1)
-  {
-    if(WheelPos < 85) {
-     return strip.Color(WheelPos * 3, 255 - WheelPos * 3, 0);
-    } else if(WheelPos < 170) {
-     WheelPos -= 85;
-     return strip.Color(255 - WheelPos * 3, 0, WheelPos * 3);
-    } else {
-     WheelPos -= 170;
-     return strip.Color(0, WheelPos * 3, 255 - WheelPos * 3);
-    }
-  } 
-  
-  return strip.Color(10,10,10);
-}
-
 void fullWhiteTest() {
 
-    for (int i=0; i < strip.numPixels(); i++) 
-      {
-     strip.setPixelColor(i, strip.Color(255,255,255));
-      }
+    strip.fill(0, strip.numPixels(), strip.Color(255,255,255));
     strip.show();
 }
 
@@ -898,9 +871,9 @@ uint32_t dampenBrightness(uint32_t c, int brightness) {
 
  byte  r, g, b;
   
-  g = ((c >> 16) & 0x7f)/brightness;
-  r = ((c >>  8) & 0x7f)/brightness;
-  b = (c        & 0x7f)/brightness; 
+  r = strip.red(c)/brightness;
+  g = strip.green(c)/brightness;
+  b = strip.blue(c)/brightness;
 
   return(strip.Color(r,g,b));
 
@@ -33,28 +33,54 @@
  How to program modes:
  Modes are all loops which set each individual pixel of the LED strips. The pixels can be set withot changing their state (strip.setPixelColor()). They change color only upon the strip being refreshed (strip.show()).
  There is limited RAM available so keep frame buffers small.
+ Each mode has an entry in modeTable (orion.cpp) giving its render function, frame delay, and when it wants a new random color, and an ORION_MODE_* option below to build it in or leave it out.
 
  Key methods:
  strip.numPixels()            Returns the total number of pixels in the strip. Alternatively, use numberPixels.
- strip.Color(r, g, b)         Returns a uint32_t variable for the specified r,g,b combination
+ strip.Color(r, g, b)         Returns a uint32_t variable for the specified r,g,b combination, in the strip's own format
+ strip.red(c), green(c), blue(c)  Take a color from strip.Color() or Wheel() apart again. Channels run 0-OrionStrip::channelMax.
  strip.setPixelColor(i, c)    Sets the pixel at position i to the color c (a uint32_t). 
  strip.show()                 Refreshes the pixels. All LEDs are updated. To maximize performance, limit this call.
  delay(x)                     Delay the program for x number of milliseconds. Used to calibrate speed of modes.
  globalSpeed                  This is a universal speed used in the delay(x) calls within the animations.
  animationStep                A variable constrained to the range 0-384. Use this to animate your modes. Each mode must control its use of animationStep
  frameStep                    Tracks the frame position 0-PIXEL_COUNT. Uses to retain frame position between frame draws.
+                              Both advance with elapsed time, so they can move by more than one between frames when a mode is slow to draw.
+ previousFrameStep            frameStep when the previous frame was drawn.
+ animationWrapped, frameWrapped  Set when the matching step came back around to 0 since the previous frame. Use these (not a test for 0) to start a new cycle.
 */
 #include <Arduino.h>
+#include "strip.h"
+#include "LPD8806.h"
+#include "WS2811.h"
 
 // Current draw per meter (32 pixels) at 100%, 50%, 25% brightness
 // Rainbow Mode 200mA / 90mA / 45 mA
 // Full White 500mA / 250mA / 125mA
 
+// Current budget for the strip. Frames that would draw more are dimmed.
+// The budget is full down to BATTERY_FULL_MILLIVOLTS and shrinks linearly
+// to CURRENT_BUDGET_LOW_MA at BATTERY_LOW_MILLIVOLTS, so a sagging pack is
+// not pulled into a brownout.
+#define CURRENT_BUDGET_MA        1500
+#define CURRENT_BUDGET_LOW_MA     600
+#define BATTERY_FULL_MILLIVOLTS  3700
+#define BATTERY_LOW_MILLIVOLTS   3300
+
 // User defined option
-#define NUMBER_OF_MODES          12
 #define NUMBER_SPEED_SETTINGS    10
 #define NUMBER_BRIGHTNESS_LEVELS  5
 
+// Animation clock. At speed setting 1 a step lasts frameDelayTimer times
+// ANIMATION_STEP_MICROS; each further setting adds that much again.
+// Time beyond MAX_STEP_ELAPSED_MICROS between two frames is dropped.
+#define ANIMATION_STEP_MICROS     1000
+#define MAX_STEP_ELAPSED_MICROS 100000UL
+
+// loop() idles the CPU between frames when the next one is at least this
+// far off. Timer0 wakes it every 1024 us regardless.
+#define IDLE_MIN_MICROS           1024
+
 // Set numberPixels to the total number of LEDs in your strip
 // The LED strips are 32 LEDs per meter and can be cut or extended in units of 2 LEDs at the cut lines
 // The driver can handle up to 128 pixels. Battery life is proportional to the number of pixels used. 
@@ -63,12 +89,38 @@
 // Change this variable to match the number of pixels in your setup
 // If numberPixels is less than the total LEDs connected, some LEDs will go unlit
 // If numberPixels is greater than the total LEDs connected, you will get lower performance than if it exactly matches.
+#ifndef PIXEL_COUNT
 #define PIXEL_COUNT  32
+#endif
 
 // Defines LED type. 
 // Type 0 is LPD8806
 // Type 1 is WS2811
+#ifndef LED_TYPE
 #define LED_TYPE      0
+#endif
+
+// WS2811 only: 1 sends frames through the SPI peripheral on MOSI with
+// interrupts left on (see NEO_SPI in WS2811.cpp), 0 through the timed loop
+// with interrupts off for the whole frame.
+#ifndef WS2811_USE_SPI
+#define WS2811_USE_SPI 0
+#endif
+
+// 1 keeps the pixel data in the strip object itself (StaticStrip, strip.h),
+// so it counts in the RAM the build takes and strip.numPixels() is a
+// constant. 0 allocates it when the strip is constructed, and the strip
+// stays dark (0 pixels) if there is not enough left.
+#ifndef ORION_STATIC_PIXELS
+#define ORION_STATIC_PIXELS 1
+#endif
+
+// RAM to leave for the stack, the Arduino core, USB and the rest of the
+// program. With ORION_STATIC_PIXELS, a PIXEL_COUNT whose pixel data and
+// mode scratch memory do not leave this much fails to compile.
+#ifndef ORION_RAM_RESERVE_BYTES
+#define ORION_RAM_RESERVE_BYTES 768
+#endif
 
 #if LED_TYPE == 0
 #define WHEEL_RANGE  384
@@ -77,11 +129,104 @@
 #define WHEEL_RANGE  255
 #endif
 
-#define PI 3.14159265
-#define dist(a, b, c, d) sqrt(double((a - c) * (a - c) + (b - d) * (b - d)))
+// The strip driver and the format of its pixels: channel depth and order.
+#if LED_TYPE == 0
+typedef LPD8806 OrionDriver;
+typedef PixelFormat<7, ORDER_GRB, 0x80> OrionFormat;
+#endif
+#if LED_TYPE == 1
+typedef WS2811 OrionDriver;
+typedef PixelFormat<8, ORDER_GRB> OrionFormat;
+#endif
+
+#if ORION_STATIC_PIXELS
+typedef StaticStrip<OrionDriver, OrionFormat, PIXEL_COUNT> OrionStrip;
+#else
+typedef Strip<OrionDriver, OrionFormat> OrionStrip;
+#endif
+
+extern OrionStrip strip;
+
+// The current one channel draws at full scale (OrionStrip::channelMax).
+// LPD8806: full white is 500mA per 32 pixels, see above.
+// WS2811: 20mA per channel, typical of WS2812 type LEDs.
+#if LED_TYPE == 0
+#define CHANNEL_FULL_MICROAMPS  5200
+#endif
+#if LED_TYPE == 1
+#define CHANNEL_FULL_MICROAMPS 20000
+#endif
+
+// Modes built in. Set any of these to 0 to leave a mode out of the build,
+// e.g. to make room on an installation that only uses a few of them.
+#ifndef ORION_MODE_RAINBOW
+#define ORION_MODE_RAINBOW              1
+#endif
+#ifndef ORION_MODE_RAINBOW_BREATHING
+#define ORION_MODE_RAINBOW_BREATHING    1
+#endif
+#ifndef ORION_MODE_PLASMA
+#define ORION_MODE_PLASMA               1
+#endif
+#ifndef ORION_MODE_SPLIT_COLOR_BUILDER
+#define ORION_MODE_SPLIT_COLOR_BUILDER  1
+#endif
+#ifndef ORION_MODE_SMOOTH_COLORS
+#define ORION_MODE_SMOOTH_COLORS        1
+#endif
+#ifndef ORION_MODE_COLOR_CHASE
+#define ORION_MODE_COLOR_CHASE          1
+#endif
+#ifndef ORION_MODE_COLOR_WIPE
+#define ORION_MODE_COLOR_WIPE           1
+#endif
+#ifndef ORION_MODE_DITHER
+#define ORION_MODE_DITHER               1
+#endif
+#ifndef ORION_MODE_SCANNER
+#define ORION_MODE_SCANNER              1
+#endif
+#ifndef ORION_MODE_WAVE
+#define ORION_MODE_WAVE                 1
+#endif
+#ifndef ORION_MODE_RANDOM_SPARKLE
+#define ORION_MODE_RANDOM_SPARKLE       1
+#endif
+#ifndef ORION_MODE_FADE
+#define ORION_MODE_FADE                 1
+#endif
+#ifndef ORION_MODE_SPARKLER
+#define ORION_MODE_SPARKLER             1
+#endif
+
+#define NUMBER_OF_MODES (ORION_MODE_RAINBOW + ORION_MODE_RAINBOW_BREATHING + \
+  ORION_MODE_PLASMA + ORION_MODE_SPLIT_COLOR_BUILDER + ORION_MODE_SMOOTH_COLORS + \
+  ORION_MODE_COLOR_CHASE + ORION_MODE_COLOR_WIPE + ORION_MODE_DITHER + \
+  ORION_MODE_SCANNER + ORION_MODE_WAVE + ORION_MODE_RANDOM_SPARKLE + \
+  ORION_MODE_FADE + ORION_MODE_SPARKLER)
+
+#if NUMBER_OF_MODES == 0
+#error "At least one ORION_MODE_* option must be enabled"
+#endif
+
+// When a mode drawing with a random color picks a new one.
+#define RESEED_NEVER     0 // Mode does not use a random color
+#define RESEED_FRAME     1 // Each time frameStep comes back around to 0
+#define RESEED_ANIMATION 2 // Each time animationStep comes back around to 0
+
+// An entry of the mode table (orion.cpp).
+struct ModeDescriptor {
+  void     (*render)(void); // Draws one frame
+  uint8_t  frameDelay;      // frameDelayTimer for the mode (step length in ms at speed 1)
+  uint8_t  reseed;          // When to pick a new random color (RESEED_*)
+};
+
+extern const ModeDescriptor modeTable[NUMBER_OF_MODES] PROGMEM;
 
 void setupOrion(void);
 void updateOrion(void);
+unsigned long microsToNextFrame(void);
+void idleUntilNextFrame(void);
 
 void stepMode(void);
 void stepSpeed(void);
@@ -111,10 +256,15 @@ void dither(uint32_t c);             // Random multi-color dither. Medium drain
 void scanner(uint32_t c);            // Bounced a 5 pixel wide color band across the strip.
 void wave(uint32_t c);               // Sine wave color ranges from full white to c. Random colors. High drain mode.
 void randomSparkle();                // Sparkles with random colors at random points. Medium drain mode.
+void randomColorChase(void);         // The modes above drawing with a random color, as in the mode table.
+void randomColorWipe(void);
+void randomDither(void);
+void randomScanner(void);
+void randomWave(void);
+void randomFade(void);               // fadeIn() then fadeOut() over each animation cycle.
 void fullWhiteTest();
 
 // Internal utility functions.
-uint32_t Wheel(uint16_t WheelPos);
 uint32_t dampenBrightness(uint32_t c, int brightness);
 
 #endif
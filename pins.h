@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 
+// Arduino pin numbers, for attachInterrupt() and the ADC.
+
 // Pins for the RGB status led.  LOW is on, HIGH is off.
 #define PIN_LED_RED       8 // Red
 #define PIN_LED_GREEN     9 // Green
@@ -19,9 +21,53 @@
 #define PIN_V_SENSE       5
 #define PIN_CHARGE_HIGH  11
 
+// The same pins as ATmega32U4 port bits, resolved at compile time so
+// that setting, clearing or reading one is a single sbi/cbi/sbic rather
+// than a digitalWrite()/digitalRead() call through the pin tables.
+// Keep these in step with the Arduino pin numbers above.
+
+// Data space addresses of the PINx registers; DDRx and PORTx follow each.
+#define PORT_B 0x23
+#define PORT_C 0x26
+#define PORT_D 0x29
+
+template<uint8_t Port, uint8_t Bit>
+struct Pin {
+  static const uint8_t port = Port;
+  static const uint8_t mask = 1 << Bit;
+
+  static volatile uint8_t &inReg(void)  { return _MMIO_BYTE(Port); }
+  static volatile uint8_t &ddrReg(void) { return _MMIO_BYTE(Port + 1); }
+  static volatile uint8_t &outReg(void) { return _MMIO_BYTE(Port + 2); }
+
+  static void    high(void)        { outReg() |=  mask; }
+  static void    low(void)         { outReg() &= ~mask; }
+  static boolean read(void)        { return (inReg() & mask) != 0; }
+  static void    output(void)      { ddrReg() |=  mask; }
+  static void    inputPullup(void) { ddrReg() &= ~mask; outReg() |= mask; }
+};
+
+// Sets the bits of PORTx in 'mask' to those of 'value', in one write.
+template<uint8_t Port>
+inline void writePort(uint8_t mask, uint8_t value) {
+  volatile uint8_t &out = _MMIO_BYTE(Port + 2);
+  out = (out & ~mask) | (value & mask);
+}
+
+typedef Pin<PORT_B, 4> LedRedPin;        // D8
+typedef Pin<PORT_B, 5> LedGreenPin;      // D9
+typedef Pin<PORT_C, 6> LedBluePin;       // D5
+
+typedef Pin<PORT_B, 6> ButtonModePin;    // D10
+typedef Pin<PORT_B, 0> ButtonSpeedPin;   // D17
+typedef Pin<PORT_D, 1> ButtonLevelPin;   // D2, INT1
+typedef Pin<PORT_D, 0> ButtonPowerPin;   // D3, INT0
+
+typedef Pin<PORT_C, 7> StripEnablePin;   // D13, LOW powers the strip
+typedef Pin<PORT_B, 7> ChargeHighPin;    // D11
+
 void setupPins(void);
 
 #endif
 
 // End of file.
-
@@ -0,0 +1,134 @@
+// Frame profiler. Each stage keeps the shortest, longest and total time of
+// its runs. show() is usually called from within a mode's render, so its
+// time is taken back out of the render stage: a render-bound mode shows up
+// in 'render', an SPI-bound one in 'show'.
+#include "profiler.h"
+
+#if ORION_PROFILE
+
+// Microseconds per Timer3 tick at the /64 prescaler.
+#define PROFILE_TICK_MICROS (64000000UL / F_CPU)
+
+struct ProfileStats {
+  uint16_t minTicks, maxTicks;
+  uint32_t totalTicks, runs;
+};
+
+static const char *const stageNames[PROFILE_STAGES] = {
+  "input", "battery", "render", "show", "latency"
+};
+
+static ProfileStats stats[PROFILE_STAGES];
+static uint16_t renderShowTicks;  // Time spent in show() during the current render
+static unsigned long startMillis; // When counting (re)started
+
+static void resetProfiler(void) {
+  for(uint8_t i = 0; i < PROFILE_STAGES; i++) {
+    stats[i].minTicks   = 0xFFFF;
+    stats[i].maxTicks   = 0;
+    stats[i].totalTicks = 0;
+    stats[i].runs       = 0;
+  }
+  startMillis = millis();
+} // resetProfiler()
+
+
+// Prints a fixed point value with the given number of decimals.
+static void printFixed(uint32_t value, uint16_t scale) {
+  Serial.print(value / scale);
+  Serial.print('.');
+  for(uint16_t digit = scale / 10; digit; digit /= 10)
+    Serial.print((value / digit) % 10);
+} // printFixed()
+
+
+static void reportProfile(void) {
+  unsigned long elapsed = millis() - startMillis;
+  uint32_t frames    = stats[PROFILE_RENDER].runs;
+  uint32_t showCalls = stats[PROFILE_SHOW].runs;
+
+  Serial.println("stage\truns\tmin us\tavg us\tmax us");
+  for(uint8_t i = 0; i < PROFILE_STAGES; i++) {
+    ProfileStats &s = stats[i];
+    Serial.print(stageNames[i]);
+    Serial.print('\t');
+    Serial.print(s.runs);
+    Serial.print('\t');
+    Serial.print(s.runs ? s.minTicks * PROFILE_TICK_MICROS : 0);
+    Serial.print('\t');
+    Serial.print(s.runs ? s.totalTicks / s.runs * PROFILE_TICK_MICROS : 0);
+    Serial.print('\t');
+    Serial.println(s.maxTicks * PROFILE_TICK_MICROS);
+  }
+
+  Serial.print("fps ");
+  printFixed(elapsed ? frames * 10000 / elapsed : 0, 10);
+  Serial.print("\tshow/frame ");
+  printFixed(frames ? showCalls * 100 / frames : 0, 100);
+  Serial.println();
+} // reportProfile()
+
+
+void setupProfiler(void) {
+  // Timer3 free running at F_CPU/64, normal mode, no interrupts.
+  TCCR3A = 0;
+  TCCR3B = (1 << CS31) | (1 << CS30);
+  TCNT3  = 0;
+
+  Serial.begin(115200);
+  resetProfiler();
+} // setupProfiler()
+
+
+// Handles report requests from the host. Call once per loop().
+void updateProfiler(void) {
+  while(Serial.available() > 0) {
+    switch(Serial.read()) {
+      case 'p':
+        reportProfile();
+        break;
+      case 'r':
+        resetProfiler();
+        break;
+    }
+  }
+} // updateProfiler()
+
+
+uint16_t profileBegin(uint8_t stage) {
+  if(stage == PROFILE_RENDER)
+    renderShowTicks = 0;
+  return TCNT3;
+} // profileBegin()
+
+
+static void recordTicks(uint8_t stage, uint16_t ticks) {
+  ProfileStats &s = stats[stage];
+  if(ticks < s.minTicks) s.minTicks = ticks;
+  if(ticks > s.maxTicks) s.maxTicks = ticks;
+  s.totalTicks += ticks;
+  s.runs++;
+} // recordTicks()
+
+
+void profileEnd(uint8_t stage, uint16_t start) {
+  uint16_t ticks = TCNT3 - start;
+
+  if(stage == PROFILE_SHOW)
+    renderShowTicks += ticks;
+  if(stage == PROFILE_RENDER)
+    ticks = ticks > renderShowTicks ? ticks - renderShowTicks : 0;
+
+  recordTicks(stage, ticks);
+} // profileEnd()
+
+
+// Button events carry micros() timestamps rather than Timer3 ones.
+void profileLatency(unsigned long micros) {
+  unsigned long ticks = micros / PROFILE_TICK_MICROS;
+  recordTicks(PROFILE_LATENCY, ticks > 0xFFFF ? 0xFFFF : ticks);
+} // profileLatency()
+
+#endif
+
+// End of file.
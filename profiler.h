@@ -0,0 +1,53 @@
+#ifndef __SYNTHESIA_PROFILER_H
+#define __SYNTHESIA_PROFILER_H
+
+#include <Arduino.h>
+
+// Frame profiler. Build with ORION_PROFILE set to 1, open the USB serial
+// port and send 'p' for a report of where the time goes, or 'r' to start
+// counting afresh. Timestamps come from Timer3, free running at F_CPU/64
+// (4 us per tick at 16 MHz), so a single stage must stay under 262 ms.
+// With ORION_PROFILE at 0 (the default) all of this compiles away.
+#ifndef ORION_PROFILE
+#define ORION_PROFILE 0
+#endif
+
+// Stages of the main loop.
+#define PROFILE_INPUT   0 // Taking the queued button events in loop()
+#define PROFILE_BATTERY 1 // updateBatteryStatus()
+#define PROFILE_RENDER  2 // Drawing a frame of the mode, less its show() calls
+#define PROFILE_SHOW    3 // strip.show()
+#define PROFILE_LATENCY 4 // From a button press being recognised to its action, via profileLatency()
+#define PROFILE_STAGES  5
+
+#if ORION_PROFILE
+
+void setupProfiler(void);
+void updateProfiler(void);
+uint16_t profileBegin(uint8_t stage);
+void profileEnd(uint8_t stage, uint16_t start);
+void profileLatency(unsigned long micros);
+
+#else
+
+inline void setupProfiler(void) {}
+inline void updateProfiler(void) {}
+inline uint16_t profileBegin(uint8_t) { return 0; }
+inline void profileEnd(uint8_t, uint16_t) {}
+inline void profileLatency(unsigned long) {}
+
+#endif
+
+// Times the rest of the enclosing block as one run of 'stage'.
+class ProfileScope {
+ public:
+  ProfileScope(uint8_t s) : stage(s), start(profileBegin(s)) {}
+  ~ProfileScope() { profileEnd(stage, start); }
+ private:
+  uint8_t  stage;
+  uint16_t start;
+};
+
+#endif
+
+// End of file.
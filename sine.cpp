@@ -0,0 +1,50 @@
+// Quarter-wave sine table: 32767*sin(i*PI/128) for i = 0..64, i.e. the
+// first 90 degrees in 64 steps plus the end point. The other three
+// quadrants are folded onto it by symmetry, so the whole wave costs 130
+// bytes of flash and no floating point at all.
+#include "sine.h"
+
+const uint16_t __sineTable[] PROGMEM = {
+      0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+   6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+  12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+  18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+  23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+  27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+  30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+  32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+  32767
+};
+
+
+// 256 steps per turn; one table entry per step, no interpolation.
+int8_t sin8(uint8_t theta) {
+  uint8_t x = theta & 0x7f; // Position within the half wave
+
+  if(x > 0x40)
+    x = 0x80 - x;           // Second quadrant mirrors the first
+
+  int8_t y = pgm_read_word(&__sineTable[x]) >> 8;
+
+  return (theta & 0x80) ? -y : y;
+} // sin8()
+
+
+// 65536 steps per turn; linear interpolation between table entries.
+int16_t sin16(uint16_t theta) {
+  uint16_t x = theta & 0x7fff; // Position within the half wave
+
+  if(x > 0x4000)
+    x = 0x8000 - x;            // Second quadrant mirrors the first
+
+  uint8_t  i    = x >> 8;
+  uint8_t  frac = x & 0xff;
+  uint16_t y    = pgm_read_word(&__sineTable[i]);
+
+  if(frac)
+    y += ((uint32_t)(pgm_read_word(&__sineTable[i + 1]) - y) * frac) >> 8;
+
+  return (theta & 0x8000) ? -(int16_t)y : (int16_t)y;
+} // sin16()
+
+// End of file.
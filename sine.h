@@ -0,0 +1,19 @@
+
+#ifndef __SYNTHESIA_SINE_H
+#define __SYNTHESIA_SINE_H
+
+#include <Arduino.h>
+
+// Fixed-point sine and cosine backed by a quarter-wave table in flash.
+// Angles are binary: a full turn is 256 for the 8-bit functions and 65536
+// for the 16-bit ones, so angle arithmetic simply wraps around.
+// sin8() returns -127..127, sin16() returns -32767..32767.
+int8_t  sin8(uint8_t theta);
+int16_t sin16(uint16_t theta);
+
+inline int8_t  cos8(uint8_t theta)   { return sin8(theta + 64); }
+inline int16_t cos16(uint16_t theta) { return sin16(theta + 16384); }
+
+#endif
+
+// End of file.
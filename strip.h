@@ -0,0 +1,88 @@
+#ifndef __SYNTHESIA_STRIP_H
+#define __SYNTHESIA_STRIP_H
+
+#include <Arduino.h>
+
+// Channel orders, as the bytes of a pixel go out on the wire.
+#define ORDER_RGB 0
+#define ORDER_GRB 1
+
+// A driver's native packed color: the three bytes of a pixel in wire
+// order, the first in bits 23-16. 'Bits' is the depth of a channel and
+// 'Mark' is set in every byte (the LPD8806 wants the high bit set).
+template<uint8_t Bits, uint8_t Order, uint8_t Mark = 0>
+struct PixelFormat {
+  static const uint8_t channelMax = (1 << Bits) - 1;
+  static const uint8_t order      = Order;
+
+  static constexpr uint32_t pack(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)((Order == ORDER_GRB ? g : r) | Mark) << 16) |
+           ((uint32_t)((Order == ORDER_GRB ? r : g) | Mark) <<  8) |
+                       (b | Mark);
+  }
+
+  static uint8_t red(uint32_t c) {
+    return (uint8_t)(c >> (Order == ORDER_GRB ? 8 : 16)) & channelMax;
+  }
+  static uint8_t green(uint32_t c) {
+    return (uint8_t)(c >> (Order == ORDER_GRB ? 16 : 8)) & channelMax;
+  }
+  static uint8_t blue(uint32_t c) {
+    return (uint8_t)c & channelMax;
+  }
+};
+
+// A strip driver with the format of its pixels fixed at compile time.
+// Modes draw through this, so the same mode code packs and unpacks colors
+// straight into whichever driver is built, with no checks at run time.
+// The driver only has to take and give back colors in its native packed
+// format: setPixelColor(n, c) and getPixelColor(n).
+template<class Driver, class Format>
+class Strip : public Driver {
+ public:
+  typedef Format format;
+  static const uint8_t channelMax = Format::channelMax;
+
+  template<typename... Args>
+  Strip(Args... args) : Driver(args...) {}
+
+  using Driver::setPixelColor;
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+    Driver::setPixelColor(n, Format::pack(r, g, b));
+  }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return Format::pack(r, g, b);
+  }
+  static uint8_t red(uint32_t c)   { return Format::red(c); }
+  static uint8_t green(uint32_t c) { return Format::green(c); }
+  static uint8_t blue(uint32_t c)  { return Format::blue(c); }
+};
+
+// Memory for the pixels of a StaticStrip, as a base class so that it is
+// in place before the driver is constructed on it.
+template<uint16_t Bytes>
+struct PixelMemory {
+  uint8_t pixelMemory[Bytes];
+};
+
+// A Strip of 'Length' pixels whose pixel data is part of the object, so it
+// is counted in the RAM the program takes at link time instead of being
+// allocated when the driver is constructed, and numPixels() is a constant.
+// The driver has to take its memory as a first constructor argument ahead
+// of the length, and give the size of it as bufferBytes(Length). Construct
+// with the rest of the driver's arguments, after the length.
+template<class Driver, class Format, uint16_t Length>
+class StaticStrip : private PixelMemory<Driver::bufferBytes(Length)>,
+                    public Strip<Driver, Format> {
+ public:
+  template<typename... Args>
+  StaticStrip(Args... args)
+    : Strip<Driver, Format>(this->pixelMemory, Length, args...) {}
+
+  static constexpr uint16_t numPixels(void) { return Length; }
+};
+
+#endif
+
+// End of file.
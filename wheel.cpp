@@ -0,0 +1,53 @@
+// The color wheel is generated by the compiler from the same piecewise
+// linear ramps that Wheel() used to evaluate on every call, and stored in
+// flash already packed the way strip.Color() would pack it.
+#include "wheel.h"
+
+constexpr uint32_t wheelPack(uint8_t r, uint8_t g, uint8_t b) {
+  return OrionStrip::format::pack(r, g, b);
+}
+
+// The ramps suit the channel depth of each strip type.
+#if LED_TYPE == 0
+
+// Three ramps of 128 steps: red down/green up, green down/blue up,
+// blue down/red up.
+constexpr uint32_t wheelEntry(uint16_t pos) {
+  return pos < 128 ? wheelPack(127 - pos, pos, 0)
+       : pos < 256 ? wheelPack(0, 255 - pos, pos - 128)
+       : pos < 384 ? wheelPack(pos - 256, 0, 383 - pos)
+       :             wheelEntry(pos - 384);
+}
+
+#endif
+
+#if LED_TYPE == 1
+
+// Three ramps of 85 steps, starting from green.
+constexpr uint32_t wheelEntry(uint16_t pos) {
+  return pos <  85 ? wheelPack(pos * 3, 255 - pos * 3, 0)
+       : pos < 170 ? wheelPack(255 - (pos - 85) * 3, 0, (pos - 85) * 3)
+       :             wheelPack(0, (pos - 170) * 3, 255 - (pos - 170) * 3);
+}
+
+#endif
+
+#define WHEEL_1(p)   wheelEntry(p),
+#define WHEEL_4(p)   WHEEL_1(p)   WHEEL_1(p + 1)   WHEEL_1(p + 2)   WHEEL_1(p + 3)
+#define WHEEL_16(p)  WHEEL_4(p)   WHEEL_4(p + 4)   WHEEL_4(p + 8)   WHEEL_4(p + 12)
+#define WHEEL_64(p)  WHEEL_16(p)  WHEEL_16(p + 16) WHEEL_16(p + 32) WHEEL_16(p + 48)
+#define WHEEL_128(p) WHEEL_64(p)  WHEEL_64(p + 64)
+
+const uint32_t __wheelTable[WHEEL_RANGE + 1] PROGMEM = {
+#if LED_TYPE == 0
+  WHEEL_128(0) WHEEL_128(128) WHEEL_128(256) WHEEL_1(384)
+#endif
+#if LED_TYPE == 1
+  WHEEL_128(0) WHEEL_128(128)
+#endif
+};
+
+static_assert(sizeof(__wheelTable) == (WHEEL_RANGE + 1) * sizeof(uint32_t),
+              "Color wheel table does not cover WHEEL_RANGE");
+
+// End of file.
@@ -0,0 +1,26 @@
+
+#ifndef __SYNTHESIA_WHEEL_H
+#define __SYNTHESIA_WHEEL_H
+
+#include <Arduino.h>
+#include "orion.h"
+
+// The color wheel, pre-packed in the strip driver's native format.
+// Entry WHEEL_RANGE wraps back around to entry 0, so any position in the
+// range 0-WHEEL_RANGE (inclusive, as animationStep runs) is valid.
+extern const uint32_t __wheelTable[WHEEL_RANGE + 1] PROGMEM;
+
+//Input a value 0 to WHEEL_RANGE to get a color value.
+//The colours are a transition r - g - b - back to r
+inline uint32_t Wheel(uint16_t WheelPos) {
+  return pgm_read_dword(&__wheelTable[WheelPos]);
+}
+
+// Same wheel addressed by an 8-bit hue, 256 steps for one full turn.
+inline uint32_t Wheel8(uint8_t hue) {
+  return Wheel(((uint16_t)hue * WHEEL_RANGE) >> 8);
+}
+
+#endif
+
+// End of file.